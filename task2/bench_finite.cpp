@@ -0,0 +1,84 @@
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "rng.h"
+#include "static_finite.h"
+
+// Sampling cost of the compile-time alias table against std::discrete_distribution, for the
+// CheckFinite example and a 64-value distribution.
+//
+//   ./bench_finite [num_samples]
+
+using TClock = std::chrono::steady_clock;
+
+static constexpr double kVals4[] = {1.0, 2.0, 3.0, 4.0};
+static constexpr double kProbs4[] = {0.4, 0.3, 0.2, 0.1};
+
+// values 0..N-1 with probabilities rising linearly
+template<size_t N>
+constexpr std::array<double, N> RampValues() {
+  std::array<double, N> v{};
+  for (size_t i = 0; i < N; i++) {
+    v[i] = double(i);
+  }
+  return v;
+}
+
+template<size_t N>
+constexpr std::array<double, N> RampProbs() {
+  std::array<double, N> p{};
+  for (size_t i = 0; i < N; i++) {
+    p[i] = double(i + 1) / double(N * (N + 1) / 2);
+  }
+  return p;
+}
+
+static constexpr auto kVals64 = RampValues<64>();
+static constexpr auto kProbs64 = RampProbs<64>();
+
+template<class TFunc>
+static void Run(const std::string& name, unsigned num_samples, TFunc&& f) {
+  double sink = 0;
+  auto t0 = TClock::now();
+  for (unsigned i = 0; i < num_samples; i++) {
+    sink += f();
+  }
+  auto t1 = TClock::now();
+  double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / num_samples;
+  std::cout << name << ": " << ns << " ns/sample (mean " << sink / num_samples << ")" << std::endl;
+}
+
+template<const auto& Values, const auto& Probs>
+static void Compare(const std::string& label, unsigned num_samples) {
+  std::mt19937_64 gen;
+
+  std::discrete_distribution<int> std_d(std::begin(Probs), std::end(Probs));
+  Run(label + " std::discrete_distribution", num_samples,
+      [&]() { return Values[std_d(gen)]; });
+
+  Run(label + " constexpr alias table     ", num_samples,
+      [&]() { return TStaticFiniteRandomNumberGenerator<Values, Probs>::Sample(gen()); });
+
+  std::vector<double> vs(std::begin(Values), std::end(Values)), ps(std::begin(Probs), std::end(Probs));
+  TRandomNumberGeneratorPtr runtime = MakeRandomNumberGenerator("finite", vs, ps);
+  Run(label + " TFinite (virtual)         ", num_samples, [&]() { return runtime->Generate(); });
+
+  TStaticFiniteRandomNumberGenerator<Values, Probs> st;
+  TRandomNumberGenerator& st_base = st;
+  Run(label + " TStaticFinite (virtual)   ", num_samples, [&]() { return st_base.Generate(); });
+
+}
+
+int main(int argc, char** argv) {
+  unsigned num_samples = argc > 1 ? std::atoi(argv[1]) : 20000000;
+
+  Compare<kVals4, kProbs4>("4 values: ", num_samples);
+  Compare<kVals64, kProbs64>("64 values:", num_samples);
+
+  return 0;
+}
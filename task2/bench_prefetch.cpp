@@ -0,0 +1,77 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "rng.h"
+#include "prefetch.h"
+
+// Per-call latency of Generate() for a direct generator and for the same generator behind
+// the prefetching ring buffer.
+//
+//   ./bench_prefetch [num_samples] [work_ns]
+//
+// work_ns is busy work done by the consumer between two samples, so that the producer thread
+// has a chance to keep up (a consumer that does nothing but sample is throughput bound, not
+// latency bound). Both columns include the cost of two steady_clock::now() calls.
+
+using TClock = std::chrono::steady_clock;
+
+static void Spin(unsigned ns) {
+  auto until = TClock::now() + std::chrono::nanoseconds(ns);
+  while (TClock::now() < until) {
+  }
+}
+
+static double Percentile(std::vector<long>& v, double q) {
+  size_t idx = size_t(q * (v.size() - 1));
+  std::nth_element(v.begin(), v.begin() + idx, v.end());
+  return double(v[idx]);
+}
+
+static void Measure(const std::string& name, TRandomNumberGenerator& g, unsigned num_samples, unsigned work_ns) {
+  std::vector<long> lat(num_samples);
+  double sink = 0;
+
+  for (unsigned i = 0; i < num_samples; i++) {
+    auto t0 = TClock::now();
+    sink += g.Generate();
+    auto t1 = TClock::now();
+    lat[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+    Spin(work_ns);
+  }
+
+  double p50 = Percentile(lat, 0.50);
+  double p99 = Percentile(lat, 0.99);
+  std::cout << name << ": p50 " << p50 << " ns, p99 " << p99 << " ns (checksum " << sink << ")" << std::endl;
+}
+
+int main(int argc, char** argv) {
+  unsigned num_samples = argc > 1 ? std::atoi(argv[1]) : 1000000;
+  unsigned work_ns = argc > 2 ? std::atoi(argv[2]) : 200;
+
+  std::cout << "samples: " << num_samples << ", consumer work: " << work_ns << " ns" << std::endl;
+
+  {
+    TRandomNumberGeneratorPtr direct = MakeRandomNumberGenerator("poisson", 40.0);
+    Measure("poisson direct    ", *direct, num_samples, work_ns);
+  }
+  {
+    TRandomNumberGeneratorPtr prefetched = MakePrefetchingRandomNumberGenerator(4096, "poisson", 40.0);
+    Measure("poisson prefetched", *prefetched, num_samples, work_ns);
+  }
+  {
+    TRandomNumberGeneratorPtr direct = MakeRandomNumberGenerator("finite",
+        std::vector<double>{1.0, 2.0, 3.0, 4.0}, std::vector<double>{0.4, 0.3, 0.2, 0.1});
+    Measure("finite direct     ", *direct, num_samples, work_ns);
+  }
+  {
+    TRandomNumberGeneratorPtr prefetched = MakePrefetchingRandomNumberGenerator(4096, "finite",
+        std::vector<double>{1.0, 2.0, 3.0, 4.0}, std::vector<double>{0.4, 0.3, 0.2, 0.1});
+    Measure("finite prefetched ", *prefetched, num_samples, work_ns);
+  }
+
+  return 0;
+}
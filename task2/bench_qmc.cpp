@@ -0,0 +1,74 @@
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "rng.h"
+#include "qmc.h"
+
+// Error of a sample-mean estimator versus sample count, for the pseudo-random generators and
+// for inversion driven by randomized Sobol and Halton sequences.
+//
+//   ./bench_qmc [replicates]
+//
+// Each cell is the root-mean-square error over independently seeded replicates, so that the
+// numbers compare like with like: the QMC error shrinks about 1/N, the pseudo-random one
+// 1/sqrt(N).
+
+using TMake = std::function<TRandomNumberGeneratorPtr(const std::string& kind)>;
+
+static double Rmse(TRandomNumberGenerator& g, unsigned n, unsigned replicates, double exact,
+                   const std::function<double(double)>& f) {
+  double sq = 0;
+  for (unsigned r = 0; r < replicates; r++) {
+    TRqmcEstimate e = RqmcMean(g, n, 1, StreamSeed(12345, r), f);
+    sq += (e.mean - exact) * (e.mean - exact);
+  }
+  return std::sqrt(sq / replicates);
+}
+
+static void Sweep(const std::string& name, const TMake& make, double exact,
+                  const std::function<double(double)>& f, unsigned replicates) {
+  std::cout << name << " (exact " << exact << ")" << std::endl;
+  std::cout << std::setw(10) << "N" << std::setw(14) << "pseudo" << std::setw(14) << "sobol"
+            << std::setw(14) << "halton" << std::endl;
+
+  TRandomNumberGeneratorPtr mc = make("");
+  TRandomNumberGeneratorPtr sobol = make("sobol");
+  TRandomNumberGeneratorPtr halton = make("halton");
+
+  for (unsigned n = 1 << 6; n <= 1 << 16; n <<= 2) {
+    std::cout << std::setw(10) << n
+              << std::setw(14) << Rmse(*mc, n, replicates, exact, f)
+              << std::setw(14) << Rmse(*sobol, n, replicates, exact, f)
+              << std::setw(14) << Rmse(*halton, n, replicates, exact, f) << std::endl;
+  }
+  std::cout << std::endl;
+}
+
+template<typename ...TArgs>
+static TMake Maker(const std::string& type, TArgs ...args) {
+  return [=](const std::string& kind) {
+    if (kind.empty()) {
+      return MakeRandomNumberGenerator(type, args...);
+    }
+    return MakeQuasiRandomNumberGenerator(kind, type, args...);
+  };
+}
+
+int main(int argc, char** argv) {
+  unsigned replicates = argc > 1 ? std::atoi(argv[1]) : 32;
+  auto id = [](double x) { return x; };
+
+  Sweep("exponential(2): E[X]", Maker("exponential", 2.0), 0.5, id, replicates);
+  Sweep("normal(0, 1): E[X^2]", Maker("normal", 0.0, 1.0), 1.0, [](double x) { return x * x; }, replicates);
+  Sweep("poisson(4): E[X]", Maker("poisson", 4.0), 4.0, id, replicates);
+  Sweep("finite {1,2,3,4}/{.4,.3,.2,.1}: E[X]",
+        Maker("finite", std::vector<double>{1.0, 2.0, 3.0, 4.0}, std::vector<double>{0.4, 0.3, 0.2, 0.1}),
+        2.0, id, replicates);
+
+  return 0;
+}
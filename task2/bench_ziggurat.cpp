@@ -0,0 +1,65 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "rng.h"
+
+// Throughput of the ziggurat-based generators against the std:: distributions they replace.
+//
+//   ./bench_ziggurat [num_samples]
+
+using TClock = std::chrono::steady_clock;
+
+template<class TFunc>
+static void Run(const std::string& name, unsigned num_samples, TFunc&& f) {
+  double sink = 0;
+  auto t0 = TClock::now();
+  for (unsigned i = 0; i < num_samples; i++) {
+    sink += f();
+  }
+  auto t1 = TClock::now();
+  double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / num_samples;
+  std::cout << name << ": " << ns << " ns/sample (checksum " << sink << ")" << std::endl;
+}
+
+static void RunBatch(const std::string& name, unsigned num_samples, TRandomNumberGenerator& g) {
+  std::vector<double> buf(4096);
+  double sink = 0;
+  auto t0 = TClock::now();
+  for (unsigned done = 0; done < num_samples; done += buf.size()) {
+    g.GenerateBatch(buf.data(), buf.size());
+    sink += buf[0];
+  }
+  auto t1 = TClock::now();
+  double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / num_samples;
+  std::cout << name << ": " << ns << " ns/sample (checksum " << sink << ")" << std::endl;
+}
+
+int main(int argc, char** argv) {
+  unsigned num_samples = argc > 1 ? std::atoi(argv[1]) : 10000000;
+
+  std::mt19937_64 gen;
+
+  std::normal_distribution<double> std_normal(0.0, 1.0);
+  Run("std::normal_distribution     ", num_samples, [&]() { return std_normal(gen); });
+  TRandomNumberGeneratorPtr normal = MakeRandomNumberGenerator("normal", 0.0, 1.0);
+  Run("normal (ziggurat)            ", num_samples, [&]() { return normal->Generate(); });
+  RunBatch("normal (ziggurat, batch)     ", num_samples, *normal);
+
+  std::exponential_distribution<double> std_exp(1.0);
+  Run("std::exponential_distribution", num_samples, [&]() { return std_exp(gen); });
+  TRandomNumberGeneratorPtr exp = MakeRandomNumberGenerator("exponential", 1.0);
+  Run("exponential (ziggurat)       ", num_samples, [&]() { return exp->Generate(); });
+  RunBatch("exponential (ziggurat, batch)", num_samples, *exp);
+
+  std::gamma_distribution<double> std_gamma(3.0, 2.0);
+  Run("std::gamma_distribution      ", num_samples, [&]() { return std_gamma(gen); });
+  TRandomNumberGeneratorPtr gamma = MakeRandomNumberGenerator("gamma", 3.0, 2.0);
+  Run("gamma (Marsaglia-Tsang)      ", num_samples, [&]() { return gamma->Generate(); });
+  RunBatch("gamma (Marsaglia-Tsang, batch)", num_samples, *gamma);
+
+  return 0;
+}
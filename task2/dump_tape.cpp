@@ -0,0 +1,121 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "rng.h"
+#include "tape.h"
+
+// Writes a sample tape (see tape.h) and reports the write rate.
+//
+//   ./dump_tape <path> <num_samples> <type> <params...> [--threads N] [--chunk N] [--seed S] [--sync]
+//
+// params by type:
+//   poisson L | bernoulli P | geometric P | exponential L
+//   normal MEAN STDDEV | gamma SHAPE SCALE
+//   finite V1,V2,... P1,P2,...
+//
+// With --verify the tape is read back and compared with a second, single-threaded generation.
+
+static std::vector<double> ParseList(const std::string& s) {
+  std::vector<double> out;
+  std::istringstream is(s);
+  std::string item;
+  while (std::getline(is, item, ',')) {
+    out.push_back(std::atof(item.c_str()));
+  }
+  return out;
+}
+
+static void Usage() {
+  std::cerr << "usage: dump_tape <path> <num_samples> <type> <params...> "
+               "[--threads N] [--chunk N] [--seed S] [--sync] [--verify]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 4) {
+    Usage();
+    return 1;
+  }
+
+  std::string path = argv[1];
+  uint64_t num_samples = std::strtoull(argv[2], nullptr, 10);
+  std::string type = argv[3];
+
+  std::vector<std::string> params;
+  TTapeOptions opts;
+  bool verify = false;
+
+  for (int i = 4; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--threads" && i + 1 < argc) {
+      opts.threads = std::atoi(argv[++i]);
+    } else if (arg == "--chunk" && i + 1 < argc) {
+      opts.chunk_samples = std::strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "--seed" && i + 1 < argc) {
+      opts.seed = std::strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "--sync") {
+      opts.sync = true;
+    } else if (arg == "--verify") {
+      verify = true;
+    } else {
+      params.push_back(arg);
+    }
+  }
+
+  TRandomNumberGeneratorFactory make;
+  if (type == "finite" && params.size() == 2) {
+    std::vector<double> vs = ParseList(params[0]), ps = ParseList(params[1]);
+    make = [=]() { return MakeRandomNumberGenerator(type, vs, ps); };
+  } else if ((type == "normal" || type == "gamma") && params.size() == 2) {
+    double a = std::atof(params[0].c_str()), b = std::atof(params[1].c_str());
+    make = [=]() { return MakeRandomNumberGenerator(type, a, b); };
+  } else if (params.size() == 1) {
+    double a = std::atof(params[0].c_str());
+    make = [=]() { return MakeRandomNumberGenerator(type, a); };
+  } else {
+    Usage();
+    return 1;
+  }
+
+  if (!make()) {
+    std::cerr << "Bad generator parameters" << std::endl;
+    return 1;
+  }
+
+  auto t0 = std::chrono::steady_clock::now();
+  if (!WriteSampleTape(path, num_samples, make, opts)) {
+    return 1;
+  }
+  auto t1 = std::chrono::steady_clock::now();
+
+  double sec = std::chrono::duration<double>(t1 - t0).count();
+  double mb = num_samples * sizeof(double) / 1e6;
+  std::cout << path << ": " << num_samples << " samples, " << mb << " MB in " << sec << " s, "
+            << mb / sec << " MB/s" << std::endl;
+
+  if (verify) {
+    TSampleTape tape;
+    if (!tape.Open(path)) {
+      return 1;
+    }
+
+    TRandomNumberGeneratorPtr g = make();
+    std::vector<double> chunk;
+    uint64_t mismatches = 0;
+    for (uint64_t begin = 0, k = 0; begin < tape.Size(); begin += opts.chunk_samples, k++) {
+      chunk.resize(std::min<uint64_t>(opts.chunk_samples, tape.Size() - begin));
+      g->Seed(StreamSeed(opts.seed, k));
+      g->GenerateBatch(chunk.data(), chunk.size());
+      for (size_t i = 0; i < chunk.size(); i++) {
+        mismatches += chunk[i] != tape.Data()[begin + i];
+      }
+    }
+    std::cout << "verify: " << mismatches << " mismatches" << std::endl;
+    return mismatches == 0 ? 0 : 1;
+  }
+
+  return 0;
+}
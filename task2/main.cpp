@@ -1,146 +1,17 @@
+#include <cmath>
 #include <iostream>
 #include <vector>
 #include <memory>
 #include <random>
+#include <string>
 #include <type_traits>
 
-static const unsigned kNumIters = 10000;
-static const double kValEps = 1e-10;  // to check double value == 0 in normal conditions
-
-// -------------------------------------------------------------------------------------------------
-
-class TRandomNumberGenerator {
- public:
-  virtual ~TRandomNumberGenerator() {}
-  virtual double Generate() = 0;
-};
-
-using TRandomNumberGeneratorPtr = std::unique_ptr<TRandomNumberGenerator>;
-
-class TPoissonRandomNumberGenerator : public TRandomNumberGenerator {
- public:
-  TPoissonRandomNumberGenerator(double lambda) : d(lambda) {
-
-  }
-  double Generate() override {
-    return double(d(gen));
-  }
- private:
-  std::poisson_distribution<int> d;
-  std::default_random_engine gen;
-};
-
-class TBernoulliRandomNumberGenerator : public TRandomNumberGenerator {
- public:
-  TBernoulliRandomNumberGenerator(double p) : d(p) {}
-  double Generate() override {
-    if (d(gen)) {
-      return 1.0;
-    } else {
-      return 0.0;
-    }
-  }
- private:
-  std::bernoulli_distribution d;
-  std::default_random_engine gen;
-};
-
-class TGeometricRandomNumberGenerator : public TRandomNumberGenerator {
- public:
-  TGeometricRandomNumberGenerator(double p) : d(p) {}
-  double Generate() override {
-    return d(gen);
-  }
- private:
-  std::geometric_distribution<int> d;
-  std::default_random_engine gen;
-};
-
-class TFiniteRandomNumberGenerator : public TRandomNumberGenerator {
- public:
-  template<class ValueIterator, class ProbIterator>
-  TFiniteRandomNumberGenerator(ValueIterator v_begin, ValueIterator v_end, ProbIterator p_begin, ProbIterator p_end)
-    : d(p_begin, p_end), vals(v_begin, v_end) {}
-  double Generate() override {
-    return vals[d(gen)];
-  }
- private:
-  std::discrete_distribution<int> d;
-  std::vector<double> vals;
-  std::default_random_engine gen;
-};
-
-// -------------------------------------------------------------------------------------------------
-
-template<class TConcreteRng, typename ...Targs>
-TRandomNumberGeneratorPtr MakeConcrete(const Targs&...) {
-  std::cerr << "Unknown constructor" << std::endl;
-  return nullptr;
-}
-
-template<>
-TRandomNumberGeneratorPtr MakeConcrete<TPoissonRandomNumberGenerator>(const double& lambda) {
-  if (lambda <= 0) {
-    return nullptr;
-  }
-
-  return std::make_unique<TPoissonRandomNumberGenerator>(lambda);
-}
-
-template<>
-TRandomNumberGeneratorPtr MakeConcrete<TBernoulliRandomNumberGenerator>(const double& p) {
-  if (p < 0 || p > 1.0) {
-    return nullptr;
-  }
-
-  return std::make_unique<TBernoulliRandomNumberGenerator>(p);
-}
-
-template<>
-TRandomNumberGeneratorPtr MakeConcrete<TGeometricRandomNumberGenerator>(const double& p) {
-  if (p < 0 || p > 1.0) {
-    return nullptr;
-  }
-
-  return std::make_unique<TGeometricRandomNumberGenerator>(p);
-}
-
-
-
-template<>
-TRandomNumberGeneratorPtr MakeConcrete<TFiniteRandomNumberGenerator>
-                          (const std::vector<double>& vs, const std::vector<double>& ps) {
-  double psum = 0;
-  for (auto p: ps) {
-    psum += p;
-  }
+#include "rng.h"
+#include "prefetch.h"
+#include "qmc.h"
+#include "static_finite.h"
 
-  if (std::abs(1.0 - psum) >= kValEps) {
-    return nullptr;
-  }
-
-  if (vs.size() != ps.size()) {
-    return nullptr;
-  }
-
-  return std::make_unique<TFiniteRandomNumberGenerator>(vs.cbegin(), vs.cend(), ps.cbegin(), ps.cend());
-}
-
-template<typename ...TArgs>
-TRandomNumberGeneratorPtr MakeRandomNumberGenerator(const std::string& type, TArgs ...args) {
-  if (type == "poisson") {
-    return MakeConcrete<TPoissonRandomNumberGenerator>(args...);
-  } else if (type == "bernoulli") {
-    return MakeConcrete<TBernoulliRandomNumberGenerator>(args...);
-  } else if (type == "geometric") {
-    return MakeConcrete<TGeometricRandomNumberGenerator>(args...);
-  } else if (type == "finite") {
-    return MakeConcrete<TFiniteRandomNumberGenerator>(args...);
-  } else {
-    std::cout << "unknown type: " << type << std::endl;
-    return nullptr;
-  }
-}
+static const unsigned kNumIters = 10000;
 
 // -------------------------------------------------------------------------------------------------
 
@@ -245,6 +116,179 @@ bool CheckFinite(const std::vector<double>& vals, const std::vector<double>& pro
   return std::abs(exp - mean) < max_difference;
 }
 
+// mean over num_iters samples taken through the batch path
+double BatchMean(TRandomNumberGenerator& g, unsigned num_iters) {
+  std::vector<double> buf(num_iters);
+  g.GenerateBatch(buf.data(), buf.size());
+
+  double sum = 0;
+  for (double v: buf) {
+    sum += v;
+  }
+  return sum / num_iters;
+}
+
+bool CheckNormal(double m, double s, double max_difference = 1e-1, unsigned num_iters = kNumIters) {
+  TRandomNumberGeneratorPtr p = MakeRandomNumberGenerator("normal", m, s);
+  if (!p) {
+    std::cerr << "Error creating Normal generator with m=" << m << ", s=" << s << std::endl;
+    return false;
+  }
+
+  double exp_mean = 0, exp_sq = 0;
+  for (unsigned i = 0; i < num_iters; i++) {
+    double v = p->Generate();
+    exp_mean += v;
+    exp_sq += v * v;
+  }
+
+  exp_mean /= num_iters;
+  double exp_stddev = std::sqrt(exp_sq / num_iters - exp_mean * exp_mean);
+  double batch_mean = BatchMean(*p, num_iters);
+
+  std::cout << "Normal(m=" << m << ", s=" << s << ") experimental mean " << exp_mean
+            << " (batch " << batch_mean << "), stddev " << exp_stddev << std::endl;
+
+  return std::abs(m - exp_mean) < max_difference && std::abs(m - batch_mean) < max_difference
+      && std::abs(s - exp_stddev) < max_difference;
+}
+
+bool CheckExponential(double l, double max_difference = 1e-1, unsigned num_iters = kNumIters) {
+  TRandomNumberGeneratorPtr p = MakeRandomNumberGenerator("exponential", l);
+  if (!p) {
+    std::cerr << "Error creating Exponential generator with l=" << l << std::endl;
+    return false;
+  }
+
+  std::exponential_distribution<double> distr(l);
+  double mean = 1.0 / distr.lambda();
+  double exp_mean = 0;
+
+  for (unsigned i = 0; i < num_iters; i++) {
+    exp_mean += p->Generate();
+  }
+
+  exp_mean /= num_iters;
+  double batch_mean = BatchMean(*p, num_iters);
+
+  std::cout << "Exponential(l=" << l << ") analytic mean: " << mean << ", experimental " << exp_mean
+            << " (batch " << batch_mean << ")" << std::endl;
+
+  return std::abs(mean - exp_mean) < max_difference && std::abs(mean - batch_mean) < max_difference;
+}
+
+bool CheckGamma(double k, double theta, double max_difference = 1e-1, unsigned num_iters = kNumIters) {
+  TRandomNumberGeneratorPtr p = MakeRandomNumberGenerator("gamma", k, theta);
+  if (!p) {
+    std::cerr << "Error creating Gamma generator with k=" << k << ", theta=" << theta << std::endl;
+    return false;
+  }
+
+  std::gamma_distribution<double> distr(k, theta);
+  double mean = distr.alpha() * distr.beta();
+  double exp_mean = 0;
+
+  for (unsigned i = 0; i < num_iters; i++) {
+    exp_mean += p->Generate();
+  }
+
+  exp_mean /= num_iters;
+  double batch_mean = BatchMean(*p, num_iters);
+
+  std::cout << "Gamma(k=" << k << ", theta=" << theta << ") analytic mean: " << mean
+            << ", experimental " << exp_mean << " (batch " << batch_mean << ")" << std::endl;
+
+  return std::abs(mean - exp_mean) < max_difference && std::abs(mean - batch_mean) < max_difference;
+}
+
+static constexpr double kStaticVals[] = {1.0, 2.0, 3.0, 4.0};
+static constexpr double kStaticProbs[] = {0.4, 0.3, 0.2, 0.1};
+
+bool CheckStaticFinite(double max_difference = 1e-1, unsigned num_iters = kNumIters) {
+  TStaticFiniteRandomNumberGenerator<kStaticVals, kStaticProbs> g;
+
+  double mean = 0;
+  for (unsigned i = 0; i < g.kSize; i++) {
+    mean += kStaticVals[i] * kStaticProbs[i];
+  }
+
+  double exp = 0;
+  for (unsigned i = 0; i < num_iters; i++) {
+    exp += g.Generate();
+  }
+
+  exp /= num_iters;
+
+  std::cout << "StaticFinite(...) mean " << mean << ", experimental " << exp << std::endl;
+  return std::abs(exp - mean) < max_difference;
+}
+
+// randomized QMC: same mean as the pseudo-random generator, with a much smaller error bar
+bool CheckQuasiRandom(const std::string& kind, double l, double max_difference = 1e-2,
+                      unsigned num_iters = kNumIters) {
+  TRandomNumberGeneratorPtr p = MakeQuasiRandomNumberGenerator(kind, "exponential", l);
+  if (!p) {
+    std::cerr << "Error creating " << kind << " exponential generator with l=" << l << std::endl;
+    return false;
+  }
+
+  double mean = 1.0 / l;
+  TRqmcEstimate e = RqmcMean(*p, num_iters / 10, 10);
+
+  std::cout << "Exponential(l=" << l << ", " << kind << ") analytic mean: " << mean
+            << ", experimental " << e.mean << " +- " << e.std_error << std::endl;
+  return std::abs(mean - e.mean) < max_difference;
+}
+
+bool CheckQuasiRandomPoisson(const std::string& kind, double l, unsigned num_iters = kNumIters) {
+  TRandomNumberGeneratorPtr p = MakeQuasiRandomNumberGenerator(kind, "poisson", l);
+  if (!p) {
+    std::cerr << "Error creating " << kind << " Poisson generator with l=" << l << std::endl;
+    return false;
+  }
+
+  TRqmcEstimate e = RqmcMean(*p, num_iters / 10, 10);
+
+  std::cout << "Poisson(l=" << l << ", " << kind << ") analytic mean: " << l
+            << ", experimental " << e.mean << " +- " << e.std_error << std::endl;
+  return std::abs(l - e.mean) < 1e-2 * l;
+}
+
+// a generator restored from a checkpoint must continue the same sequence as the original
+bool CheckRestore(const std::string& type, TRandomNumberGeneratorPtr p) {
+  if (!p) {
+    std::cerr << "Error creating " << type << " generator" << std::endl;
+    return false;
+  }
+
+  for (unsigned i = 0; i < 1000; i++) {
+    p->Generate();
+  }
+
+  std::string blob = CheckpointRandomNumberGenerator(*p);
+  TRandomNumberGeneratorPtr restored = RestoreRandomNumberGenerator(blob);
+  if (!restored) {
+    std::cerr << "Error restoring " << type << " generator" << std::endl;
+    return false;
+  }
+
+  unsigned mismatches = 0;
+  for (unsigned i = 0; i < kNumIters; i++) {
+    if (p->Generate() != restored->Generate()) {
+      mismatches++;
+    }
+  }
+
+  std::cout << "Checkpoint(" << type << "): " << blob.size() << " bytes, "
+            << mismatches << " mismatches after restore" << std::endl;
+  return mismatches == 0;
+}
+
+template<typename ...TArgs>
+bool CheckCheckpoint(const std::string& type, TArgs ...args) {
+  return CheckRestore(type, MakeRandomNumberGenerator(type, args...));
+}
+
 // -------------------------------------------------------------------------------------------------
 
 int main(int argc, char** argv) {
@@ -256,6 +300,28 @@ int main(int argc, char** argv) {
   CheckGeometric(0.5);
   CheckGeometric(0.3);
   CheckFinite({1.0, 2.0, 3.0, 4.0}, {0.4, 0.3, 0.2, 0.1});
+  CheckStaticFinite();
+  CheckNormal(0.0, 1.0);
+  CheckNormal(5.0, 2.0);
+  CheckExponential(1.0);
+  CheckExponential(4.0);
+  CheckGamma(0.5, 1.0);
+  CheckGamma(3.0, 2.0, 2e-1);
+  CheckQuasiRandom("sobol", 1.0);
+  CheckQuasiRandom("halton", 4.0);
+  CheckQuasiRandomPoisson("sobol", 3.0);
+  CheckQuasiRandomPoisson("sobol", 1000.0);
+  CheckQuasiRandomPoisson("halton", 1e6);
+
+  CheckCheckpoint("poisson", 0.5);
+  CheckCheckpoint("poisson", 40.0);
+  CheckCheckpoint("bernoulli", 0.5);
+  CheckCheckpoint("geometric", 0.3);
+  CheckCheckpoint("finite", std::vector<double>{1.0, 2.0, 3.0, 4.0}, std::vector<double>{0.4, 0.3, 0.2, 0.1});
+  CheckCheckpoint("normal", 0.0, 1.0);
+  CheckCheckpoint("exponential", 2.0);
+  CheckCheckpoint("gamma", 0.5, 1.0);
+  CheckRestore("prefetching", MakePrefetchingRandomNumberGenerator(256, "poisson", 4.0));
 
   return 0;
 }
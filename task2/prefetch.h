@@ -0,0 +1,237 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "rng.h"
+
+// Wraps any generator and keeps a ring buffer of its samples filled from a dedicated
+// producer thread, so Generate() on the consumer side is a load from the buffer.
+//
+// The ring is single-producer/single-consumer: the producer owns tail_, the consumer owns
+// head_, and each side keeps a cached copy of the opposite index so that the common path
+// touches no shared cache line. The producer refills up to high_watermark and then parks
+// until the consumer drains the buffer down to low_watermark.
+//
+// Generate(), Seed(), SaveState() and LoadState() must be called from one (consumer) thread
+// at a time.
+class TPrefetchingRandomNumberGenerator : public TRandomNumberGenerator {
+ public:
+  static const size_t kDefaultCapacity = 4096;
+
+  // capacity is rounded up to a power of two; watermarks of 0 pick capacity / 4 and capacity
+  TPrefetchingRandomNumberGenerator(TRandomNumberGeneratorPtr source,
+                                    size_t capacity = kDefaultCapacity,
+                                    size_t low_watermark = 0, size_t high_watermark = 0)
+    : source_(std::move(source))
+    , buf_(RoundUpPow2(capacity))
+    , mask_(buf_.size() - 1)
+    , low_(low_watermark ? low_watermark : buf_.size() / 4)
+    , high_(high_watermark ? high_watermark : buf_.size()) {
+    if (high_ > buf_.size()) {
+      high_ = buf_.size();
+    }
+    if (low_ >= high_) {
+      low_ = high_ - 1;
+    }
+    producer_ = std::thread([this]() { Produce(); });
+  }
+
+  ~TPrefetchingRandomNumberGenerator() {
+    {
+      std::lock_guard<std::mutex> g(park_mutex_);
+      stop_ = true;
+      parked_ = false;
+    }
+    park_cv_.notify_one();
+    producer_.join();
+  }
+
+  double Generate() override {
+    size_t head = head_.load(std::memory_order_relaxed);
+
+    if (head == cached_tail_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      while (head == cached_tail_) {
+        WakeProducer();
+        std::this_thread::yield();
+        cached_tail_ = tail_.load(std::memory_order_acquire);
+      }
+      below_low_ = false;
+    }
+
+    double val = buf_[head & mask_];
+    head_.store(head + 1, std::memory_order_release);
+
+    // the cached window ran down to the low watermark: look at the real fill level once and
+    // wake the producer once per crossing, not on every sample until the window is used up
+    if (!below_low_ && cached_tail_ - head - 1 <= low_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (cached_tail_ - head - 1 <= low_) {
+        below_low_ = true;
+        WakeProducer();
+      }
+    }
+
+    return val;
+  }
+
+  size_t Capacity() const {
+    return buf_.size();
+  }
+
+  // drops the buffered samples so that the next Generate() is the first sample of the new stream
+  void Seed(uint64_t seed) override {
+    std::lock_guard<std::mutex> g(source_mutex_);
+    source_->Seed(seed);
+    size_t head = head_.load(std::memory_order_relaxed);
+    tail_.store(head, std::memory_order_release);
+    cached_tail_ = head;
+    below_low_ = false;
+  }
+
+  std::string Type() const override {
+    return "prefetching";
+  }
+
+  // The state is the source checkpoint plus the samples already buffered but not yet
+  // consumed. The producer is held off for at most one refill chunk while this is copied.
+  void SaveState(TStateWriter& w) const override {
+    std::lock_guard<std::mutex> g(source_mutex_);
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t tail = tail_.load(std::memory_order_relaxed);
+
+    w.PutString(CheckpointRandomNumberGenerator(*source_));
+    w.PutU64(tail - head);
+    for (size_t i = head; i != tail; i++) {
+      w.PutDouble(buf_[i & mask_]);
+    }
+  }
+
+  bool LoadState(TStateReader& r) override {
+    std::string source_blob;
+    uint64_t n;
+    if (!r.GetString(source_blob) || !r.GetU64(n) || n > buf_.size()) {
+      return false;
+    }
+
+    TRandomNumberGeneratorPtr source = RestoreRandomNumberGenerator(source_blob);
+    if (!source) {
+      return false;
+    }
+
+    std::vector<double> samples(n);
+    for (double& v: samples) {
+      if (!r.GetDouble(v)) {
+        return false;
+      }
+    }
+
+    std::lock_guard<std::mutex> g(source_mutex_);
+    size_t head = head_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < n; i++) {
+      buf_[(head + i) & mask_] = samples[i];
+    }
+    source_ = std::move(source);
+    tail_.store(head + n, std::memory_order_release);
+    cached_tail_ = head + n;
+    below_low_ = false;
+    return true;
+  }
+
+ private:
+  static const size_t kChunk = 64;  // samples published per tail_ store
+
+  static size_t RoundUpPow2(size_t n) {
+    size_t p = 2;
+    while (p < n) {
+      p <<= 1;
+    }
+    return p;
+  }
+
+  void WakeProducer() {
+    // pairs with the fence in Produce(): either we see parked_ or it sees our head_
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parked_.load(std::memory_order_relaxed)) {
+      {
+        std::lock_guard<std::mutex> g(park_mutex_);
+        parked_ = false;
+      }
+      park_cv_.notify_one();
+    }
+  }
+
+  void Produce() {
+    while (!stop_.load(std::memory_order_relaxed)) {
+      std::unique_lock<std::mutex> source_lock(source_mutex_);
+      size_t tail = tail_.load(std::memory_order_relaxed);
+      size_t cached_head = head_.load(std::memory_order_acquire);
+
+      if (tail - cached_head >= high_) {
+        source_lock.unlock();
+        parked_ = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (tail - head_.load(std::memory_order_relaxed) > low_) {
+          std::unique_lock<std::mutex> ul(park_mutex_);
+          park_cv_.wait(ul, [this]() { return !parked_ || stop_; });
+        }
+        parked_ = false;
+        continue;
+      }
+
+      size_t n = high_ - (tail - cached_head);
+      if (n > kChunk) {
+        n = kChunk;
+      }
+      size_t pos = tail & mask_;
+      if (n > buf_.size() - pos) {
+        n = buf_.size() - pos;  // don't wrap inside one batch
+      }
+      source_->GenerateBatch(&buf_[pos], n);
+      tail += n;
+      tail_.store(tail, std::memory_order_release);
+    }
+  }
+
+  TRandomNumberGeneratorPtr source_;
+  std::vector<double> buf_;
+  const size_t mask_;
+  size_t low_, high_;
+
+  // consumer side
+  alignas(64) std::atomic<size_t> head_{0};
+  size_t cached_tail_ = 0;
+  bool below_low_ = false;  // woke the producer since the fill level last fell to low_
+
+  // producer side
+  alignas(64) std::atomic<size_t> tail_{0};
+  mutable std::mutex source_mutex_;  // held by the producer while it advances source_
+
+  alignas(64) std::atomic_bool parked_{false};
+  std::atomic_bool stop_{false};
+  std::mutex park_mutex_;
+  std::condition_variable park_cv_;
+
+  std::thread producer_;
+};
+
+// the restored source replaces the placeholder one, the capacity stays the default
+inline const bool kPrefetchingRestorable = RegisterRestorable("prefetching", []() -> TRandomNumberGeneratorPtr {
+  return std::make_unique<TPrefetchingRandomNumberGenerator>(MakeRandomNumberGenerator("bernoulli", 0.5));
+});
+
+template<typename ...TArgs>
+TRandomNumberGeneratorPtr MakePrefetchingRandomNumberGenerator(size_t capacity, const std::string& type,
+                                                               TArgs ...args) {
+  TRandomNumberGeneratorPtr source = MakeRandomNumberGenerator(type, args...);
+  if (!source) {
+    return nullptr;
+  }
+
+  return std::make_unique<TPrefetchingRandomNumberGenerator>(std::move(source), capacity);
+}
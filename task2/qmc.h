@@ -0,0 +1,455 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "rng.h"
+
+// Quasi-Monte Carlo: low-discrepancy point sets and inversion-based generators on top of them.
+//
+// A mean estimated from N pseudo-random samples has error O(1/sqrt(N)); the same estimator fed
+// with a low-discrepancy sequence converges at close to O(1/N) for smooth integrands. Both
+// sequences here can be randomized (Sobol by a random digital shift, Halton by random digit
+// permutations), which keeps their structure but makes every estimate unbiased, so the spread
+// over independently randomized replicates gives an error bar (randomized QMC, see RqmcMean).
+
+class TLowDiscrepancySequence {
+ public:
+  virtual ~TLowDiscrepancySequence() {}
+
+  virtual unsigned Dims() const = 0;
+  // writes the next point, Dims() coordinates in (0, 1)
+  virtual void Next(double* point) = 0;
+  // rewinds to the first point
+  virtual void Reset() = 0;
+  // rewinds and applies a fresh randomization derived from seed
+  virtual void Randomize(uint64_t seed) = 0;
+  // point index, for checkpoints
+  virtual uint64_t Position() const = 0;
+  virtual void Skip(uint64_t n) = 0;
+};
+
+using TLowDiscrepancySequencePtr = std::unique_ptr<TLowDiscrepancySequence>;
+
+// Sobol sequence in base 2 with the Joe & Kuo (2008) direction numbers, up to kMaxDims
+// dimensions and 2^32 points. Points are generated in Gray-code order, one XOR per coordinate.
+class TSobolSequence : public TLowDiscrepancySequence {
+ public:
+  static const unsigned kMaxDims = 16;
+  static const unsigned kBits = 32;
+
+  TSobolSequence(unsigned dims) : dims_(std::min(std::max(dims, 1u), kMaxDims)),
+      v_(dims_ * kBits), x_(dims_), shift_(dims_) {
+    // degree s, coefficients a, initial m_1..m_s (new-joe-kuo-6.21201)
+    static const struct {
+      unsigned s, a;
+      uint32_t m[6];
+    } kInit[kMaxDims - 1] = {
+      {1, 0, {1}},
+      {2, 1, {1, 3}},
+      {3, 1, {1, 3, 1}},
+      {3, 2, {1, 1, 1}},
+      {4, 1, {1, 1, 3, 3}},
+      {4, 4, {1, 3, 5, 13}},
+      {5, 2, {1, 1, 5, 5, 17}},
+      {5, 4, {1, 1, 5, 5, 5}},
+      {5, 7, {1, 1, 7, 11, 19}},
+      {5, 11, {1, 1, 5, 1, 1}},
+      {5, 13, {1, 1, 1, 3, 11}},
+      {5, 14, {1, 3, 5, 5, 31}},
+      {6, 1, {1, 3, 3, 9, 7, 49}},
+      {6, 13, {1, 1, 1, 15, 21, 21}},
+      {6, 16, {1, 3, 1, 13, 27, 49}},
+    };
+
+    // first dimension is the van der Corput sequence
+    for (unsigned k = 0; k < kBits; k++) {
+      v_[k] = uint32_t(1) << (kBits - 1 - k);
+    }
+
+    for (unsigned d = 1; d < dims_; d++) {
+      uint32_t* v = &v_[d * kBits];
+      unsigned s = kInit[d - 1].s, a = kInit[d - 1].a;
+
+      for (unsigned k = 0; k < kBits; k++) {
+        if (k < s) {
+          v[k] = kInit[d - 1].m[k] << (kBits - 1 - k);
+        } else {
+          v[k] = v[k - s] ^ (v[k - s] >> s);
+          for (unsigned j = 1; j < s; j++) {
+            if ((a >> (s - 1 - j)) & 1) {
+              v[k] ^= v[k - j];
+            }
+          }
+        }
+      }
+    }
+  }
+
+  unsigned Dims() const override {
+    return dims_;
+  }
+
+  void Next(double* point) override {
+    for (unsigned d = 0; d < dims_; d++) {
+      // midpoint of the 2^-32 cell keeps coordinates away from 0 and 1
+      point[d] = (double(x_[d] ^ shift_[d]) + 0.5) * (1.0 / 4294967296.0);
+    }
+
+    // Gray code: the next point differs in the direction number of the lowest zero bit
+    unsigned c = 0;
+    for (uint64_t i = index_; i & 1; i >>= 1) {
+      c++;
+    }
+    index_++;
+    if (c < kBits) {
+      for (unsigned d = 0; d < dims_; d++) {
+        x_[d] ^= v_[d * kBits + c];
+      }
+    }
+  }
+
+  void Reset() override {
+    index_ = 0;
+    std::fill(x_.begin(), x_.end(), 0);
+  }
+
+  void Randomize(uint64_t seed) override {
+    Reset();
+    std::mt19937_64 gen(seed);
+    for (unsigned d = 0; d < dims_; d++) {
+      shift_[d] = uint32_t(gen() >> 32);
+    }
+  }
+
+  uint64_t Position() const override {
+    return index_;
+  }
+
+  void Skip(uint64_t n) override {
+    // x for index i is the XOR of the direction numbers of the bits of gray(i)
+    index_ += n;
+    uint64_t gray = index_ ^ (index_ >> 1);
+    for (unsigned d = 0; d < dims_; d++) {
+      uint32_t x = 0;
+      for (unsigned k = 0; k < kBits; k++) {
+        if ((gray >> k) & 1) {
+          x ^= v_[d * kBits + k];
+        }
+      }
+      x_[d] = x;
+    }
+  }
+
+ private:
+  unsigned dims_;
+  std::vector<uint32_t> v_;  // direction numbers, kBits per dimension
+  std::vector<uint32_t> x_;
+  std::vector<uint32_t> shift_;
+  uint64_t index_ = 0;
+};
+
+// Halton sequence, dimension d in base of the d-th prime. Randomize() draws an independent
+// digit permutation for every digit position (random-permutation scrambling), which also
+// removes the strong correlation between high dimensions of the plain sequence.
+class THaltonSequence : public TLowDiscrepancySequence {
+ public:
+  static const unsigned kMaxDims = 16;
+
+  THaltonSequence(unsigned dims) : dims_(std::min(std::max(dims, 1u), kMaxDims)), perms_(dims_) {
+    static const unsigned kPrimes[kMaxDims] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53};
+
+    for (unsigned d = 0; d < dims_; d++) {
+      unsigned b = kPrimes[d];
+      bases_.push_back(b);
+      // enough digits to resolve a double
+      digits_.push_back(unsigned(std::ceil(53.0 / std::log2(double(b)))));
+    }
+    Randomize(0);
+    for (unsigned d = 0; d < dims_; d++) {
+      for (auto& perm: perms_[d]) {
+        for (unsigned i = 0; i < perm.size(); i++) {
+          perm[i] = i;
+        }
+      }
+    }
+  }
+
+  unsigned Dims() const override {
+    return dims_;
+  }
+
+  void Next(double* point) override {
+    for (unsigned d = 0; d < dims_; d++) {
+      const unsigned b = bases_[d];
+      const double inv_b = 1.0 / b;
+      double scale = inv_b, u = 0;
+      uint64_t i = index_;
+
+      for (unsigned j = 0; j < digits_[d]; j++) {
+        u += perms_[d][j][i % b] * scale;
+        i /= b;
+        scale *= inv_b;
+      }
+      // midpoint of the smallest cell, as in TSobolSequence
+      point[d] = u + 0.5 * scale * b;
+    }
+    index_++;
+  }
+
+  void Reset() override {
+    index_ = 0;
+  }
+
+  void Randomize(uint64_t seed) override {
+    Reset();
+    std::mt19937_64 gen(seed);
+    for (unsigned d = 0; d < dims_; d++) {
+      perms_[d].resize(digits_[d]);
+      for (auto& perm: perms_[d]) {
+        perm.resize(bases_[d]);
+        for (unsigned i = 0; i < perm.size(); i++) {
+          perm[i] = i;
+        }
+        std::shuffle(perm.begin(), perm.end(), gen);
+      }
+    }
+  }
+
+  uint64_t Position() const override {
+    return index_;
+  }
+
+  void Skip(uint64_t n) override {
+    index_ += n;
+  }
+
+ private:
+  unsigned dims_;
+  std::vector<unsigned> bases_;
+  std::vector<unsigned> digits_;
+  std::vector<std::vector<std::vector<unsigned>>> perms_;  // [dim][digit position][digit]
+  uint64_t index_ = 0;
+};
+
+inline TLowDiscrepancySequencePtr MakeLowDiscrepancySequence(const std::string& kind, unsigned dims) {
+  if (kind == "sobol") {
+    return std::make_unique<TSobolSequence>(dims);
+  } else if (kind == "halton") {
+    return std::make_unique<THaltonSequence>(dims);
+  } else {
+    std::cerr << "unknown sequence: " << kind << std::endl;
+    return nullptr;
+  }
+}
+
+// -------------------------------------------------------------------------------------------------
+
+namespace qmc {
+
+// Inverse standard normal CDF: Acklam's rational approximation refined by one Halley step,
+// accurate to double precision.
+inline double NormalQuantile(double p) {
+  static const double a[] = {-3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+                             1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00};
+  static const double b[] = {-5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+                             6.680131188771972e+01, -1.328068155288572e+01};
+  static const double c[] = {-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+                             -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00};
+  static const double d[] = {7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+                             3.754408661907416e+00};
+  const double p_low = 0.02425;
+
+  double x;
+  if (p < p_low) {
+    double q = std::sqrt(-2 * std::log(p));
+    x = (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5])
+        / ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+  } else if (p <= 1 - p_low) {
+    double q = p - 0.5, r = q * q;
+    x = (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q
+        / (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1);
+  } else {
+    double q = std::sqrt(-2 * std::log(1 - p));
+    x = -(((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5])
+        / ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+  }
+
+  double e = 0.5 * std::erfc(-x / std::sqrt(2.0)) - p;
+  double u = e * std::sqrt(2 * M_PI) * std::exp(x * x / 2);
+  return x - u / (1 + x * u / 2);
+}
+
+}  // namespace qmc
+
+using TInverseCdf = std::function<double(double)>;
+
+// Inverse CDF of a factory distribution; an empty function if the type or parameters are
+// invalid or the distribution has no practical inverse (gamma).
+template<class ...TArgs>
+TInverseCdf MakeInverseCdf(const std::string&, const TArgs&...) {
+  return nullptr;
+}
+
+inline TInverseCdf MakeInverseCdf(const std::string& type, double a) {
+  if (type == "poisson" && a > 0) {
+    // CDF tabulated over mean +- 12 standard deviations (plus a margin for small means), the
+    // pmf computed in log space so that large means don't underflow exp(-a); sampling is a
+    // binary search
+    double half_width = 12 * std::sqrt(a) + 20;
+    double lo = std::max(0.0, std::floor(a - half_width));
+    size_t n = size_t(std::ceil(a + half_width) - lo) + 1;
+    std::vector<double> cdf(n);
+    double sum = 0;
+    for (size_t i = 0; i < n; i++) {
+      double k = lo + i;
+      sum += std::exp(k * std::log(a) - a - std::lgamma(k + 1));
+      cdf[i] = sum;
+    }
+    for (double& c: cdf) {
+      c /= sum;  // the mass outside the table is below double precision
+    }
+    return [lo, cdf](double u) {
+      size_t i = std::upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+      return lo + double(std::min(i, cdf.size() - 1));
+    };
+  } else if (type == "bernoulli" && a >= 0 && a <= 1) {
+    return [a](double u) { return u > 1 - a ? 1.0 : 0.0; };
+  } else if (type == "geometric" && a > 0 && a <= 1) {
+    if (a == 1) {
+      return [](double) { return 0.0; };
+    }
+    double denom = std::log1p(-a);
+    return [denom](double u) { return std::floor(std::log1p(-u) / denom); };
+  } else if (type == "exponential" && a > 0) {
+    return [a](double u) { return -std::log1p(-u) / a; };
+  }
+  return nullptr;
+}
+
+inline TInverseCdf MakeInverseCdf(const std::string& type, double a, double b) {
+  if (type == "normal" && b > 0) {
+    return [a, b](double u) { return a + b * qmc::NormalQuantile(u); };
+  }
+  return nullptr;
+}
+
+inline TInverseCdf MakeInverseCdf(const std::string& type, const std::vector<double>& vs,
+                                  const std::vector<double>& ps) {
+  if (type != "finite" || vs.empty() || vs.size() != ps.size()) {
+    return nullptr;
+  }
+
+  std::vector<double> cdf(ps.size());
+  double sum = 0;
+  for (size_t i = 0; i < ps.size(); i++) {
+    sum += ps[i];
+    cdf[i] = sum;
+  }
+  if (std::abs(1.0 - sum) >= kValEps) {
+    return nullptr;
+  }
+
+  return [vs, cdf](double u) {
+    size_t i = std::upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+    return vs[std::min(i, vs.size() - 1)];
+  };
+}
+
+// A factory distribution sampled by inversion of the first coordinate of a low-discrepancy
+// sequence. Seed() re-randomizes the sequence, so that independent seeds give independent
+// randomized-QMC replicates.
+class TQuasiRandomNumberGenerator : public TRandomNumberGenerator {
+ public:
+  TQuasiRandomNumberGenerator(TLowDiscrepancySequencePtr seq, TInverseCdf icdf)
+    : seq_(std::move(seq)), icdf_(std::move(icdf)), point_(seq_->Dims()) {}
+
+  double Generate() override {
+    seq_->Next(point_.data());
+    return icdf_(point_[0]);
+  }
+  void Seed(uint64_t seed) override {
+    seed_ = seed;
+    seq_->Randomize(seed);
+  }
+  // configuration, not state; see RestoreRandomNumberGenerator
+  std::string Type() const override {
+    return "qmc";
+  }
+  // the sequence and the transform are configuration; only the randomization and position are state
+  void SaveState(TStateWriter& w) const override {
+    w.PutU64(seed_);
+    w.PutU64(seq_->Position());
+  }
+  bool LoadState(TStateReader& r) override {
+    uint64_t seed, pos;
+    if (!r.GetU64(seed) || !r.GetU64(pos)) {
+      return false;
+    }
+    Seed(seed);
+    seq_->Skip(pos);
+    return true;
+  }
+ private:
+  TLowDiscrepancySequencePtr seq_;
+  TInverseCdf icdf_;
+  std::vector<double> point_;
+  uint64_t seed_ = 0;
+};
+
+// kind is "sobol" or "halton"; the generator starts randomized with seed 0
+template<typename ...TArgs>
+TRandomNumberGeneratorPtr MakeQuasiRandomNumberGenerator(const std::string& kind, const std::string& type,
+                                                         TArgs ...args) {
+  TInverseCdf icdf = MakeInverseCdf(type, args...);
+  if (!icdf) {
+    std::cerr << "no inverse CDF for " << type << std::endl;
+    return nullptr;
+  }
+
+  TLowDiscrepancySequencePtr seq = MakeLowDiscrepancySequence(kind, 1);
+  if (!seq) {
+    return nullptr;
+  }
+
+  auto g = std::make_unique<TQuasiRandomNumberGenerator>(std::move(seq), std::move(icdf));
+  g->Seed(0);
+  return g;
+}
+
+struct TRqmcEstimate {
+  double mean;
+  double std_error;
+};
+
+// Mean of f(sample) from `replicates` independently seeded runs of n samples each, with the
+// standard error from the spread of the replicate means. Works with any generator; for a
+// pseudo-random one it is plain Monte Carlo with the same total of n * replicates samples.
+template<class TFunc>
+TRqmcEstimate RqmcMean(TRandomNumberGenerator& g, unsigned n, unsigned replicates, uint64_t seed, TFunc&& f) {
+  double sum = 0, sum_sq = 0;
+
+  for (unsigned r = 0; r < replicates; r++) {
+    g.Seed(StreamSeed(seed, r));
+    double m = 0;
+    for (unsigned i = 0; i < n; i++) {
+      m += f(g.Generate());
+    }
+    m /= n;
+    sum += m;
+    sum_sq += m * m;
+  }
+
+  double mean = sum / replicates;
+  double var = replicates > 1 ? (sum_sq - replicates * mean * mean) / (replicates - 1) : 0;
+  return {mean, std::sqrt(std::max(var, 0.0) / replicates)};
+}
+
+inline TRqmcEstimate RqmcMean(TRandomNumberGenerator& g, unsigned n, unsigned replicates, uint64_t seed = 0) {
+  return RqmcMean(g, n, replicates, seed, [](double x) { return x; });
+}
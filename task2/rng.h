@@ -0,0 +1,439 @@
+#pragma once
+
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <vector>
+#include <memory>
+#include <random>
+#include <string>
+
+#include "state.h"
+#include "ziggurat.h"
+
+static constexpr double kValEps = 1e-10;  // to check double value == 0 in normal conditions
+
+// -------------------------------------------------------------------------------------------------
+
+class TRandomNumberGenerator {
+ public:
+  virtual ~TRandomNumberGenerator() {}
+  virtual double Generate() = 0;
+
+  // fills out[0..n); generators with a cheap inner loop override this to avoid a virtual
+  // call per sample
+  virtual void GenerateBatch(double* out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      out[i] = Generate();
+    }
+  }
+
+  // Restarts the generator on the stream identified by seed: same seed, same sequence.
+  // Distribution parameters are kept, cached values are dropped.
+  virtual void Seed(uint64_t seed) = 0;
+
+  // name the generator's checkpoints are tagged with: the MakeRandomNumberGenerator type for
+  // factory generators, the RegisterRestorable name for the others that
+  // RestoreRandomNumberGenerator can recreate
+  virtual std::string Type() const = 0;
+
+  // Full state: distribution parameters, engine and any cached values. A generator that
+  // loads a saved state continues exactly the sequence the saved one would have produced.
+  virtual void SaveState(TStateWriter& w) const = 0;
+  virtual bool LoadState(TStateReader& r) = 0;
+};
+
+using TRandomNumberGeneratorPtr = std::unique_ptr<TRandomNumberGenerator>;
+
+class TPoissonRandomNumberGenerator : public TRandomNumberGenerator {
+ public:
+  TPoissonRandomNumberGenerator(double lambda) : d(lambda) {
+
+  }
+  double Generate() override {
+    return double(d(gen));
+  }
+  void Seed(uint64_t seed) override {
+    gen.seed(std::default_random_engine::result_type(seed));
+    d.reset();
+  }
+  std::string Type() const override {
+    return "poisson";
+  }
+  void SaveState(TStateWriter& w) const override {
+    w.PutStreamed(d);
+    w.PutEngine(gen);
+  }
+  bool LoadState(TStateReader& r) override {
+    return r.GetStreamed(d) && r.GetEngine(gen);
+  }
+ private:
+  std::poisson_distribution<int> d;
+  std::default_random_engine gen;
+};
+
+class TBernoulliRandomNumberGenerator : public TRandomNumberGenerator {
+ public:
+  TBernoulliRandomNumberGenerator(double p) : d(p) {}
+  double Generate() override {
+    if (d(gen)) {
+      return 1.0;
+    } else {
+      return 0.0;
+    }
+  }
+  void Seed(uint64_t seed) override {
+    gen.seed(std::default_random_engine::result_type(seed));
+    d.reset();
+  }
+  std::string Type() const override {
+    return "bernoulli";
+  }
+  void SaveState(TStateWriter& w) const override {
+    w.PutStreamed(d);
+    w.PutEngine(gen);
+  }
+  bool LoadState(TStateReader& r) override {
+    return r.GetStreamed(d) && r.GetEngine(gen);
+  }
+ private:
+  std::bernoulli_distribution d;
+  std::default_random_engine gen;
+};
+
+class TGeometricRandomNumberGenerator : public TRandomNumberGenerator {
+ public:
+  TGeometricRandomNumberGenerator(double p) : d(p) {}
+  double Generate() override {
+    return d(gen);
+  }
+  void Seed(uint64_t seed) override {
+    gen.seed(std::default_random_engine::result_type(seed));
+    d.reset();
+  }
+  std::string Type() const override {
+    return "geometric";
+  }
+  void SaveState(TStateWriter& w) const override {
+    w.PutStreamed(d);
+    w.PutEngine(gen);
+  }
+  bool LoadState(TStateReader& r) override {
+    return r.GetStreamed(d) && r.GetEngine(gen);
+  }
+ private:
+  std::geometric_distribution<int> d;
+  std::default_random_engine gen;
+};
+
+class TFiniteRandomNumberGenerator : public TRandomNumberGenerator {
+ public:
+  template<class ValueIterator, class ProbIterator>
+  TFiniteRandomNumberGenerator(ValueIterator v_begin, ValueIterator v_end, ProbIterator p_begin, ProbIterator p_end)
+    : d(p_begin, p_end), vals(v_begin, v_end) {}
+  double Generate() override {
+    return vals[d(gen)];
+  }
+  void Seed(uint64_t seed) override {
+    gen.seed(std::default_random_engine::result_type(seed));
+    d.reset();
+  }
+  std::string Type() const override {
+    return "finite";
+  }
+  void SaveState(TStateWriter& w) const override {
+    w.PutStreamed(d);
+    w.PutDoubles(vals.data(), vals.size());
+    w.PutEngine(gen);
+  }
+  bool LoadState(TStateReader& r) override {
+    return r.GetStreamed(d) && r.GetDoubles(vals) && r.GetEngine(gen)
+        && vals.size() == d.probabilities().size();
+  }
+ private:
+  std::discrete_distribution<int> d;
+  std::vector<double> vals;
+  std::default_random_engine gen;
+};
+
+// The ziggurat-based generators below need 64 random bits per draw, which
+// std::default_random_engine (31-bit LCG in libstdc++) can't give in one call.
+
+class TNormalRandomNumberGenerator : public TRandomNumberGenerator {
+ public:
+  TNormalRandomNumberGenerator(double mean, double stddev) : mean(mean), stddev(stddev) {}
+  double Generate() override {
+    return mean + stddev * ziggurat::Normal(gen, tables);
+  }
+  void GenerateBatch(double* out, size_t n) override {
+    for (size_t i = 0; i < n; i++) {
+      out[i] = mean + stddev * ziggurat::Normal(gen, tables);
+    }
+  }
+  void Seed(uint64_t seed) override {
+    gen.seed(seed);
+  }
+  std::string Type() const override {
+    return "normal";
+  }
+  void SaveState(TStateWriter& w) const override {
+    w.PutDouble(mean);
+    w.PutDouble(stddev);
+    w.PutEngine(gen);
+  }
+  bool LoadState(TStateReader& r) override {
+    return r.GetDouble(mean) && r.GetDouble(stddev) && r.GetEngine(gen);
+  }
+ private:
+  double mean, stddev;
+  const ziggurat::TNormalTables& tables = ziggurat::TNormalTables::Get();
+  std::mt19937_64 gen;
+};
+
+class TExponentialRandomNumberGenerator : public TRandomNumberGenerator {
+ public:
+  TExponentialRandomNumberGenerator(double lambda) : inv_lambda(1.0 / lambda) {}
+  double Generate() override {
+    return inv_lambda * ziggurat::Exponential(gen, tables);
+  }
+  void GenerateBatch(double* out, size_t n) override {
+    for (size_t i = 0; i < n; i++) {
+      out[i] = inv_lambda * ziggurat::Exponential(gen, tables);
+    }
+  }
+  void Seed(uint64_t seed) override {
+    gen.seed(seed);
+  }
+  std::string Type() const override {
+    return "exponential";
+  }
+  void SaveState(TStateWriter& w) const override {
+    w.PutDouble(inv_lambda);
+    w.PutEngine(gen);
+  }
+  bool LoadState(TStateReader& r) override {
+    return r.GetDouble(inv_lambda) && r.GetEngine(gen);
+  }
+ private:
+  double inv_lambda;
+  const ziggurat::TExponentialTables& tables = ziggurat::TExponentialTables::Get();
+  std::mt19937_64 gen;
+};
+
+class TGammaRandomNumberGenerator : public TRandomNumberGenerator {
+ public:
+  TGammaRandomNumberGenerator(double shape, double scale) : shape(shape), scale(scale) {}
+  double Generate() override {
+    return scale * ziggurat::Gamma(gen, shape, tables);
+  }
+  void GenerateBatch(double* out, size_t n) override {
+    for (size_t i = 0; i < n; i++) {
+      out[i] = scale * ziggurat::Gamma(gen, shape, tables);
+    }
+  }
+  void Seed(uint64_t seed) override {
+    gen.seed(seed);
+  }
+  std::string Type() const override {
+    return "gamma";
+  }
+  void SaveState(TStateWriter& w) const override {
+    w.PutDouble(shape);
+    w.PutDouble(scale);
+    w.PutEngine(gen);
+  }
+  bool LoadState(TStateReader& r) override {
+    return r.GetDouble(shape) && r.GetDouble(scale) && r.GetEngine(gen);
+  }
+ private:
+  double shape, scale;
+  const ziggurat::TNormalTables& tables = ziggurat::TNormalTables::Get();
+  std::mt19937_64 gen;
+};
+
+// -------------------------------------------------------------------------------------------------
+
+template<class TConcreteRng, typename ...Targs>
+TRandomNumberGeneratorPtr MakeConcrete(const Targs&...) {
+  std::cerr << "Unknown constructor" << std::endl;
+  return nullptr;
+}
+
+template<>
+inline TRandomNumberGeneratorPtr MakeConcrete<TPoissonRandomNumberGenerator>(const double& lambda) {
+  if (lambda <= 0) {
+    return nullptr;
+  }
+
+  return std::make_unique<TPoissonRandomNumberGenerator>(lambda);
+}
+
+template<>
+inline TRandomNumberGeneratorPtr MakeConcrete<TBernoulliRandomNumberGenerator>(const double& p) {
+  if (p < 0 || p > 1.0) {
+    return nullptr;
+  }
+
+  return std::make_unique<TBernoulliRandomNumberGenerator>(p);
+}
+
+template<>
+inline TRandomNumberGeneratorPtr MakeConcrete<TGeometricRandomNumberGenerator>(const double& p) {
+  if (p < 0 || p > 1.0) {
+    return nullptr;
+  }
+
+  return std::make_unique<TGeometricRandomNumberGenerator>(p);
+}
+
+
+
+template<>
+inline TRandomNumberGeneratorPtr MakeConcrete<TFiniteRandomNumberGenerator>
+                          (const std::vector<double>& vs, const std::vector<double>& ps) {
+  double psum = 0;
+  for (auto p: ps) {
+    psum += p;
+  }
+
+  if (std::abs(1.0 - psum) >= kValEps) {
+    return nullptr;
+  }
+
+  if (vs.size() != ps.size()) {
+    return nullptr;
+  }
+
+  return std::make_unique<TFiniteRandomNumberGenerator>(vs.cbegin(), vs.cend(), ps.cbegin(), ps.cend());
+}
+
+template<>
+inline TRandomNumberGeneratorPtr MakeConcrete<TNormalRandomNumberGenerator>(const double& mean, const double& stddev) {
+  if (stddev <= 0) {
+    return nullptr;
+  }
+
+  return std::make_unique<TNormalRandomNumberGenerator>(mean, stddev);
+}
+
+template<>
+inline TRandomNumberGeneratorPtr MakeConcrete<TExponentialRandomNumberGenerator>(const double& lambda) {
+  if (lambda <= 0) {
+    return nullptr;
+  }
+
+  return std::make_unique<TExponentialRandomNumberGenerator>(lambda);
+}
+
+template<>
+inline TRandomNumberGeneratorPtr MakeConcrete<TGammaRandomNumberGenerator>(const double& shape, const double& scale) {
+  if (shape <= 0 || scale <= 0) {
+    return nullptr;
+  }
+
+  return std::make_unique<TGammaRandomNumberGenerator>(shape, scale);
+}
+
+template<typename ...TArgs>
+TRandomNumberGeneratorPtr MakeRandomNumberGenerator(const std::string& type, TArgs ...args) {
+  if (type == "poisson") {
+    return MakeConcrete<TPoissonRandomNumberGenerator>(args...);
+  } else if (type == "bernoulli") {
+    return MakeConcrete<TBernoulliRandomNumberGenerator>(args...);
+  } else if (type == "geometric") {
+    return MakeConcrete<TGeometricRandomNumberGenerator>(args...);
+  } else if (type == "finite") {
+    return MakeConcrete<TFiniteRandomNumberGenerator>(args...);
+  } else if (type == "normal") {
+    return MakeConcrete<TNormalRandomNumberGenerator>(args...);
+  } else if (type == "exponential") {
+    return MakeConcrete<TExponentialRandomNumberGenerator>(args...);
+  } else if (type == "gamma") {
+    return MakeConcrete<TGammaRandomNumberGenerator>(args...);
+  } else {
+    std::cout << "unknown type: " << type << std::endl;
+    return nullptr;
+  }
+}
+
+// -------------------------------------------------------------------------------------------------
+
+// Seed of the stream_id-th independent stream derived from base_seed (splitmix64 finalizer),
+// so that neighbouring stream ids don't give correlated engine seeds.
+inline uint64_t StreamSeed(uint64_t base_seed, uint64_t stream_id) {
+  uint64_t z = base_seed + (stream_id + 1) * 0x9e3779b97f4a7c15ULL;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+// Generators outside the factory that RestoreRandomNumberGenerator can recreate: the function
+// makes an instance with any valid configuration, which LoadState() then overwrites. Headers
+// register their generators with an inline variable, so restoring works wherever the header is
+// included.
+using TRestorableFactory = TRandomNumberGeneratorPtr (*)();
+
+inline std::map<std::string, TRestorableFactory>& RestorableTypes() {
+  static std::map<std::string, TRestorableFactory> types;
+  return types;
+}
+
+inline bool RegisterRestorable(const std::string& type, TRestorableFactory make) {
+  RestorableTypes()[type] = make;
+  return true;
+}
+
+// Checkpoint blob: magic, format version, generator type, generator state.
+static const uint64_t kCheckpointMagic = 0x53474e52;  // "RNGS"
+static const uint64_t kCheckpointVersion = 1;
+
+// Serializes the generator into a self-describing blob. This only copies state into memory,
+// so a worker can checkpoint between two samples and hand the blob to another thread for
+// writing out.
+inline std::string CheckpointRandomNumberGenerator(const TRandomNumberGenerator& g) {
+  TStateWriter w;
+  w.PutU64(kCheckpointMagic);
+  w.PutU64(kCheckpointVersion);
+  w.PutString(g.Type());
+  g.SaveState(w);
+  return w.Release();
+}
+
+// Recreates a generator from a blob made by CheckpointRandomNumberGenerator(); returns
+// nullptr if the blob is malformed or of a type that can't be recreated (see
+// RegisterRestorable). Generators whose configuration isn't part of their state (qmc,
+// static_finite: the inverse CDF and the alias table) can't be recreated from a checkpoint;
+// they only load one into an instance built with the same configuration.
+inline TRandomNumberGeneratorPtr RestoreRandomNumberGenerator(const std::string& blob) {
+  TStateReader r(blob);
+  uint64_t magic, version;
+  std::string type;
+  if (!r.GetU64(magic) || !r.GetU64(version) || !r.GetString(type)) {
+    return nullptr;
+  }
+  if (magic != kCheckpointMagic || version != kCheckpointVersion) {
+    return nullptr;
+  }
+
+  // any valid parameters will do, LoadState() overwrites them
+  TRandomNumberGeneratorPtr g;
+  if (type == "finite") {
+    g = MakeRandomNumberGenerator(type, std::vector<double>{0.0}, std::vector<double>{1.0});
+  } else if (type == "normal" || type == "gamma") {
+    g = MakeRandomNumberGenerator(type, 1.0, 1.0);
+  } else if (type == "bernoulli" || type == "geometric") {
+    g = MakeRandomNumberGenerator(type, 0.5);
+  } else if (type == "poisson" || type == "exponential") {
+    g = MakeRandomNumberGenerator(type, 1.0);
+  } else {
+    auto f = RestorableTypes().find(type);
+    if (f != RestorableTypes().end()) {
+      g = f->second();
+    }
+  }
+
+  if (!g || !g->LoadState(r) || !r.AtEnd()) {
+    return nullptr;
+  }
+  return g;
+}
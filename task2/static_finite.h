@@ -0,0 +1,136 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <string>
+
+#include "rng.h"
+
+// Finite distribution fixed at compile time.
+//
+// Values and probabilities are constexpr arrays passed by reference as template parameters;
+// the Walker/Vose alias table is built by the compiler and lands in .rodata, so constructing
+// a generator costs nothing. A sample is one 64-bit engine word: the high half picks a slot
+// with a multiply-shift, the low half is compared against the slot threshold to choose
+// between the slot's own value and its alias:
+//
+//   static constexpr double kVals[] = {1.0, 2.0, 3.0, 4.0};
+//   static constexpr double kProbs[] = {0.4, 0.3, 0.2, 0.1};
+//   TStaticFiniteRandomNumberGenerator<kVals, kProbs> g;
+
+namespace static_finite {
+
+struct TSlot {
+  uint64_t threshold;  // keep value if the low 32 bits of the word are below this
+  double value;
+  double alias;
+};
+
+template<size_t N>
+struct TAliasTable {
+  TSlot slots[N];
+  double prob_sum;
+};
+
+template<size_t N, class TValues, class TProbs>
+constexpr TAliasTable<N> MakeAliasTable(const TValues& vals, const TProbs& probs) {
+  TAliasTable<N> t{};
+  double scaled[N] = {};
+  size_t small[N] = {}, large[N] = {};
+  size_t num_small = 0, num_large = 0;
+
+  t.prob_sum = 0;
+  for (size_t i = 0; i < N; i++) {
+    t.prob_sum += probs[i];
+  }
+
+  for (size_t i = 0; i < N; i++) {
+    scaled[i] = probs[i] / t.prob_sum * N;
+    t.slots[i].value = vals[i];
+    t.slots[i].alias = vals[i];
+    if (scaled[i] < 1.0) {
+      small[num_small++] = i;
+    } else {
+      large[num_large++] = i;
+    }
+  }
+
+  while (num_small > 0 && num_large > 0) {
+    size_t s = small[--num_small];
+    size_t l = large[--num_large];
+
+    t.slots[s].threshold = uint64_t(scaled[s] * 4294967296.0);
+    t.slots[s].alias = vals[l];
+
+    scaled[l] = scaled[l] + scaled[s] - 1.0;
+    if (scaled[l] < 1.0) {
+      small[num_small++] = l;
+    } else {
+      large[num_large++] = l;
+    }
+  }
+
+  // leftovers are 1.0 up to rounding
+  while (num_large > 0) {
+    t.slots[large[--num_large]].threshold = uint64_t(1) << 32;
+  }
+  while (num_small > 0) {
+    t.slots[small[--num_small]].threshold = uint64_t(1) << 32;
+  }
+
+  return t;
+}
+
+template<size_t N>
+constexpr double Sample(const TAliasTable<N>& t, uint64_t u) {
+  const TSlot& slot = t.slots[((u >> 32) * N) >> 32];
+  return (u & 0xffffffffu) < slot.threshold ? slot.value : slot.alias;
+}
+
+}  // namespace static_finite
+
+template<const auto& Values, const auto& Probs>
+class TStaticFiniteRandomNumberGenerator : public TRandomNumberGenerator {
+ public:
+  static constexpr size_t kSize = std::size(Values);
+  static_assert(kSize > 0, "finite distribution needs at least one value");
+  static_assert(kSize == std::size(Probs), "values and probabilities differ in size");
+
+  static constexpr static_finite::TAliasTable<kSize> kTable =
+      static_finite::MakeAliasTable<kSize>(Values, Probs);
+  static_assert(kTable.prob_sum > 1.0 - kValEps && kTable.prob_sum < 1.0 + kValEps,
+                "probabilities must sum to 1");
+
+  // one sample from a 64-bit uniform word; usable in constant expressions
+  static constexpr double Sample(uint64_t u) {
+    return static_finite::Sample(kTable, u);
+  }
+
+  double Generate() override {
+    return Sample(gen());
+  }
+  void GenerateBatch(double* out, size_t n) override {
+    for (size_t i = 0; i < n; i++) {
+      out[i] = Sample(gen());
+    }
+  }
+  void Seed(uint64_t seed) override {
+    gen.seed(seed);
+  }
+  // configuration, not state; see RestoreRandomNumberGenerator
+  std::string Type() const override {
+    return "static_finite";
+  }
+  // the table is part of the type, only the engine has state
+  void SaveState(TStateWriter& w) const override {
+    w.PutEngine(gen);
+  }
+  bool LoadState(TStateReader& r) override {
+    return r.GetEngine(gen);
+  }
+ private:
+  std::mt19937_64 gen;
+};
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "rng.h"
+
+// Sample tapes: files of pre-generated samples for downstream replay.
+//
+// Layout: a 64-byte header followed by num_samples native doubles. The samples are cut into
+// chunks of chunk_samples; chunk k is generated by a generator restarted with
+// Seed(StreamSeed(seed, k)). The content of a tape therefore depends only on the generator
+// configuration, seed and chunk size, never on the number of writer threads.
+//
+// Writers generate straight into a shared mapping of the pre-sized file with GenerateBatch(),
+// so no sample is ever copied or formatted, and start writeback of every finished chunk right
+// away so that the page cache doesn't have to absorb the whole tape before hitting the disk.
+
+static const uint64_t kTapeMagic = 0x31455041544e4752ULL;  // "RNGTAPE1"
+
+struct TTapeHeader {
+  uint64_t magic;
+  uint64_t num_samples;
+  uint64_t chunk_samples;
+  uint64_t seed;
+  uint64_t reserved[4];
+};
+
+static_assert(sizeof(TTapeHeader) == 64, "tape header must keep the samples cache-line aligned");
+
+struct TTapeOptions {
+  uint64_t chunk_samples = 1 << 20;  // 8 MB chunks
+  uint64_t seed = 0;
+  unsigned threads = 0;              // 0: one per hardware thread
+  bool sync = false;                 // msync(MS_SYNC) before returning
+};
+
+using TRandomNumberGeneratorFactory = std::function<TRandomNumberGeneratorPtr()>;
+
+// Writes a tape of num_samples to path, overwriting it. make() is called once per writer
+// thread and must return identically configured generators.
+inline bool WriteSampleTape(const std::string& path, uint64_t num_samples,
+                            const TRandomNumberGeneratorFactory& make, TTapeOptions opts = {}) {
+  if (opts.chunk_samples == 0) {
+    std::cerr << "Tape chunk size must be positive" << std::endl;
+    return false;
+  }
+  if (opts.threads == 0) {
+    opts.threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    std::cerr << "Can't open " << path << ": " << std::strerror(errno) << std::endl;
+    return false;
+  }
+
+  size_t size = sizeof(TTapeHeader) + num_samples * sizeof(double);
+  // reserve the blocks up front so that page faults in the writers never hit ENOSPC (SIGBUS)
+  int err = ::posix_fallocate(fd, 0, off_t(size));
+  if (err != 0) {
+    std::cerr << "Can't allocate " << size << " bytes for " << path << ": " << std::strerror(err) << std::endl;
+    ::close(fd);
+    return false;
+  }
+
+  void* addr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (addr == MAP_FAILED) {
+    std::cerr << "Can't map " << path << ": " << std::strerror(errno) << std::endl;
+    ::close(fd);
+    return false;
+  }
+  ::madvise(addr, size, MADV_SEQUENTIAL);
+
+  TTapeHeader* header = static_cast<TTapeHeader*>(addr);
+  std::memset(header, 0, sizeof(*header));
+  header->num_samples = num_samples;
+  header->chunk_samples = opts.chunk_samples;
+  header->seed = opts.seed;
+
+  double* samples = reinterpret_cast<double*>(header + 1);
+  uint64_t num_chunks = (num_samples + opts.chunk_samples - 1) / opts.chunk_samples;
+  std::atomic<uint64_t> next_chunk(0);
+  std::atomic_bool failed(false);
+
+  auto writer = [&]() {
+    TRandomNumberGeneratorPtr g = make();
+    if (!g) {
+      failed = true;
+      return;
+    }
+
+    for (uint64_t k = next_chunk++; k < num_chunks; k = next_chunk++) {
+      uint64_t begin = k * opts.chunk_samples;
+      uint64_t n = std::min(opts.chunk_samples, num_samples - begin);
+
+      g->Seed(StreamSeed(opts.seed, k));
+      g->GenerateBatch(samples + begin, n);
+
+      off_t off = off_t(sizeof(TTapeHeader) + begin * sizeof(double));
+      ::sync_file_range(fd, off, off_t(n * sizeof(double)), SYNC_FILE_RANGE_WRITE);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned i = 1; i < opts.threads; i++) {
+    threads.emplace_back(writer);
+  }
+  writer();
+  for (auto& t: threads) {
+    t.join();
+  }
+
+  bool ok = !failed;
+  if (ok) {
+    // the magic goes in last: a tape interrupted half-way is never mistaken for a complete one
+    header->magic = kTapeMagic;
+  } else {
+    std::cerr << "Can't create generator for " << path << std::endl;
+  }
+
+  if (opts.sync && ::msync(addr, size, MS_SYNC) != 0) {
+    std::cerr << "Can't sync " << path << ": " << std::strerror(errno) << std::endl;
+    ok = false;
+  }
+
+  ::munmap(addr, size);
+  ::close(fd);
+  return ok;
+}
+
+// Read-only view of a tape written by WriteSampleTape().
+class TSampleTape {
+ public:
+  TSampleTape() {}
+  TSampleTape(const TSampleTape&) = delete;
+  TSampleTape& operator=(const TSampleTape&) = delete;
+
+  ~TSampleTape() {
+    Close();
+  }
+
+  bool Open(const std::string& path) {
+    Close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      std::cerr << "Can't open " << path << ": " << std::strerror(errno) << std::endl;
+      return false;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(TTapeHeader)) {
+      std::cerr << "Not a sample tape: " << path << std::endl;
+      ::close(fd);
+      return false;
+    }
+
+    size_ = size_t(st.st_size);
+    addr_ = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr_ == MAP_FAILED) {
+      std::cerr << "Can't map " << path << ": " << std::strerror(errno) << std::endl;
+      addr_ = nullptr;
+      return false;
+    }
+
+    const TTapeHeader* h = Header();
+    if (h->magic != kTapeMagic || size_ != sizeof(TTapeHeader) + h->num_samples * sizeof(double)) {
+      std::cerr << "Not a complete sample tape: " << path << std::endl;
+      Close();
+      return false;
+    }
+
+    ::madvise(addr_, size_, MADV_SEQUENTIAL);
+    return true;
+  }
+
+  void Close() {
+    if (addr_) {
+      ::munmap(addr_, size_);
+      addr_ = nullptr;
+    }
+  }
+
+  const TTapeHeader* Header() const {
+    return static_cast<const TTapeHeader*>(addr_);
+  }
+
+  const double* Data() const {
+    return reinterpret_cast<const double*>(Header() + 1);
+  }
+
+  uint64_t Size() const {
+    return Header()->num_samples;
+  }
+
+ private:
+  void* addr_ = nullptr;
+  size_t size_ = 0;
+};
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+// Ziggurat method of Marsaglia & Tsang (2000) for the standard normal and standard
+// exponential distributions.
+//
+// The density is covered by N horizontal layers of equal area. A sample draws one 64-bit
+// word: the low bits pick a layer, the high 32 bits a point inside it. In ~99% of draws the
+// point lies in the rectangular core of the layer and is accepted with one compare and one
+// multiply; only the remaining draws fall back to the wedge/tail code.
+//
+// Unlike the original SHR3-based code the layer index and the value come from different
+// bits of the word, so they are independent.
+
+namespace ziggurat {
+
+// uniform double in (0, 1]
+inline double ToUnit(uint64_t u) {
+  return double((u >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+struct TNormalTables {
+  static const int kLayers = 128;
+  static constexpr double kR = 3.442619855899;     // start of the tail
+  static constexpr double kV = 9.91256303526217e-3;  // area of each layer
+
+  uint32_t k[kLayers];
+  double w[kLayers];
+  double f[kLayers];
+
+  TNormalTables() {
+    const double m1 = 2147483648.0;
+    double dn = kR, tn = kR;
+    double q = kV / std::exp(-0.5 * dn * dn);
+
+    k[0] = uint32_t((dn / q) * m1);
+    k[1] = 0;
+    w[0] = q / m1;
+    w[kLayers - 1] = dn / m1;
+    f[0] = 1.0;
+    f[kLayers - 1] = std::exp(-0.5 * dn * dn);
+
+    for (int i = kLayers - 2; i >= 1; i--) {
+      dn = std::sqrt(-2.0 * std::log(kV / dn + std::exp(-0.5 * dn * dn)));
+      k[i + 1] = uint32_t((dn / tn) * m1);
+      tn = dn;
+      f[i] = std::exp(-0.5 * dn * dn);
+      w[i] = dn / m1;
+    }
+  }
+
+  static const TNormalTables& Get() {
+    static const TNormalTables t;
+    return t;
+  }
+};
+
+struct TExponentialTables {
+  static const int kLayers = 256;
+  static constexpr double kR = 7.697117470131487;
+  static constexpr double kV = 3.949659822581572e-3;
+
+  uint32_t k[kLayers];
+  double w[kLayers];
+  double f[kLayers];
+
+  TExponentialTables() {
+    const double m2 = 4294967296.0;
+    double de = kR, te = kR;
+    double q = kV / std::exp(-de);
+
+    k[0] = uint32_t((de / q) * m2);
+    k[1] = 0;
+    w[0] = q / m2;
+    w[kLayers - 1] = de / m2;
+    f[0] = 1.0;
+    f[kLayers - 1] = std::exp(-de);
+
+    for (int i = kLayers - 2; i >= 1; i--) {
+      de = -std::log(kV / de + std::exp(-de));
+      k[i + 1] = uint32_t((de / te) * m2);
+      te = de;
+      f[i] = std::exp(-de);
+      w[i] = de / m2;
+    }
+  }
+
+  static const TExponentialTables& Get() {
+    static const TExponentialTables t;
+    return t;
+  }
+};
+
+// standard normal N(0, 1); TEngine must produce 64-bit words
+template<class TEngine>
+double Normal(TEngine& gen, const TNormalTables& t = TNormalTables::Get()) {
+  for (;;) {
+    uint64_t u = gen();
+    int iz = int(u & (TNormalTables::kLayers - 1));
+    int32_t hz = int32_t(uint32_t(u >> 32));
+    uint32_t ahz = hz < 0 ? uint32_t(-int64_t(hz)) : uint32_t(hz);
+    double x = hz * t.w[iz];
+
+    if (ahz < t.k[iz]) {
+      return x;
+    }
+
+    if (iz == 0) {
+      // tail beyond kR
+      double xt, y;
+      do {
+        xt = -std::log(ToUnit(gen())) / TNormalTables::kR;
+        y = -std::log(ToUnit(gen()));
+      } while (y + y < xt * xt);
+      return hz > 0 ? TNormalTables::kR + xt : -TNormalTables::kR - xt;
+    }
+
+    // wedge
+    if (t.f[iz] + ToUnit(gen()) * (t.f[iz - 1] - t.f[iz]) < std::exp(-0.5 * x * x)) {
+      return x;
+    }
+  }
+}
+
+// standard exponential Exp(1)
+template<class TEngine>
+double Exponential(TEngine& gen, const TExponentialTables& t = TExponentialTables::Get()) {
+  for (;;) {
+    uint64_t u = gen();
+    int iz = int(u & (TExponentialTables::kLayers - 1));
+    uint32_t jz = uint32_t(u >> 32);
+    double x = jz * t.w[iz];
+
+    if (jz < t.k[iz]) {
+      return x;
+    }
+
+    if (iz == 0) {
+      return TExponentialTables::kR - std::log(ToUnit(gen()));
+    }
+
+    if (t.f[iz] + ToUnit(gen()) * (t.f[iz - 1] - t.f[iz]) < std::exp(-x)) {
+      return x;
+    }
+  }
+}
+
+// Gamma(shape, 1) by Marsaglia & Tsang (2000), using the ziggurat normal for the proposal.
+// Shapes below 1 are boosted: Gamma(a) = Gamma(a + 1) * U^(1/a).
+template<class TEngine>
+double Gamma(TEngine& gen, double shape, const TNormalTables& t = TNormalTables::Get()) {
+  double boost = 1.0;
+  if (shape < 1.0) {
+    boost = std::pow(ToUnit(gen()), 1.0 / shape);
+    shape += 1.0;
+  }
+
+  const double d = shape - 1.0 / 3.0;
+  const double c = 1.0 / std::sqrt(9.0 * d);
+
+  for (;;) {
+    double x, v;
+    do {
+      x = Normal(gen, t);
+      v = 1.0 + c * x;
+    } while (v <= 0.0);
+
+    v = v * v * v;
+    double u = ToUnit(gen());
+    double x2 = x * x;
+
+    if (u < 1.0 - 0.0331 * x2 * x2) {
+      return d * v * boost;
+    }
+    if (std::log(u) < 0.5 * x2 + d * (1.0 - v + std::log(v))) {
+      return d * v * boost;
+    }
+  }
+}
+
+}  // namespace ziggurat
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Thread pinning and NUMA placement for the queue threads and their buffers.
+//
+// CpuTopology reads which CPUs this process may run on and how they group into SMT cores,
+// sockets and NUMA nodes from /sys. PinCurrentThread() binds a thread to one CPU. Ring memory
+// goes on the consumer's node in one of two ways:
+//  - first touch: ConstructOnCpu<SpscQueue<int>>(consumer_cpu, 1024) builds the queue on a
+//    thread pinned to that CPU, so the kernel places the zero-filled ring pages there;
+//  - BindToNode(addr, len, node) sets an mbind() policy on memory that nobody has touched
+//    yet (SlotRing takes a node for this).
+// Every function takes -1 as "no preference" and does nothing then; failures are reported on
+// std::cerr and leave the thread or memory where it was.
+
+enum class CpuRelation {
+  SameCpu,
+  SmtSiblings,  // two hardware threads of one core
+  SameSocket,   // different cores of one package
+  CrossSocket,
+};
+
+inline const char* CpuRelationName(CpuRelation r) {
+  switch (r) {
+    case CpuRelation::SameCpu: return "same cpu";
+    case CpuRelation::SmtSiblings: return "smt siblings";
+    case CpuRelation::SameSocket: return "same socket";
+    case CpuRelation::CrossSocket: return "cross socket";
+  }
+  return "?";
+}
+
+class CpuTopology {
+ public:
+  struct Cpu {
+    int id;
+    int core;    // core_id, unique within a socket
+    int socket;  // physical_package_id
+    int node;    // NUMA node, 0 if unknown
+  };
+
+  // CPUs in this process's affinity mask; falls back to one core per CPU on one socket and
+  // node where /sys doesn't say
+  static CpuTopology Read() {
+    CpuTopology t;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+      for (unsigned i = 0; i < std::thread::hardware_concurrency(); i++) {
+        CPU_SET(i, &set);
+      }
+    }
+
+    std::vector<int> node_of(CPU_SETSIZE, 0);
+    std::error_code ec;
+    for (auto& entry: std::filesystem::directory_iterator("/sys/devices/system/node", ec)) {
+      std::string name = entry.path().filename();
+      if (name.rfind("node", 0) != 0 || name.size() == 4 || !std::isdigit(name[4])) {
+        continue;
+      }
+      int node = std::stoi(name.substr(4));
+      for (int cpu: ParseList(ReadLine(entry.path() / "cpulist"))) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+          node_of[cpu] = node;
+        }
+      }
+    }
+
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (!CPU_ISSET(cpu, &set)) {
+        continue;
+      }
+      std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+      int core = ReadInt(dir + "core_id", cpu);
+      int socket = ReadInt(dir + "physical_package_id", 0);
+      t.cpus_.push_back({cpu, core, socket, node_of[cpu]});
+    }
+    return t;
+  }
+
+  const std::vector<Cpu>& Cpus() const {
+    return cpus_;
+  }
+
+  // -1 if cpu is not one of ours
+  int NodeOf(int cpu) const {
+    for (const Cpu& c: cpus_) {
+      if (c.id == cpu) {
+        return c.node;
+      }
+    }
+    return -1;
+  }
+
+  CpuRelation Relation(const Cpu& a, const Cpu& b) const {
+    if (a.id == b.id) {
+      return CpuRelation::SameCpu;
+    }
+    if (a.socket != b.socket) {
+      return CpuRelation::CrossSocket;
+    }
+    return a.core == b.core ? CpuRelation::SmtSiblings : CpuRelation::SameSocket;
+  }
+
+  // the first pair of CPUs in the given relation, {-1, -1} if there is none
+  std::pair<int, int> FindPair(CpuRelation r) const {
+    for (const Cpu& a: cpus_) {
+      for (const Cpu& b: cpus_) {
+        if (Relation(a, b) == r) {
+          return {a.id, b.id};
+        }
+      }
+    }
+    return {-1, -1};
+  }
+
+ private:
+  static std::string ReadLine(const std::filesystem::path& path) {
+    std::ifstream in(path);
+    std::string line;
+    std::getline(in, line);
+    return line;
+  }
+
+  static int ReadInt(const std::string& path, int fallback) {
+    std::string line = ReadLine(path);
+    return line.empty() ? fallback : std::atoi(line.c_str());
+  }
+
+  // "0-3,8,10-11"
+  static std::vector<int> ParseList(const std::string& list) {
+    std::vector<int> out;
+    size_t pos = 0;
+    while (pos < list.size()) {
+      size_t end = list.find(',', pos);
+      if (end == std::string::npos) {
+        end = list.size();
+      }
+      std::string range = list.substr(pos, end - pos);
+      size_t dash = range.find('-');
+      int lo = std::atoi(range.c_str());
+      int hi = dash == std::string::npos ? lo : std::atoi(range.c_str() + dash + 1);
+      for (int i = lo; i <= hi; i++) {
+        out.push_back(i);
+      }
+      pos = end + 1;
+    }
+    return out;
+  }
+
+  std::vector<Cpu> cpus_;
+};
+
+// binds the calling thread to one CPU; -1 leaves it floating
+inline bool PinCurrentThread(int cpu) {
+  if (cpu < 0) {
+    return true;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  if (err != 0) {
+    std::cerr << "pinning to cpu " << cpu << ": " << std::strerror(err) << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// Sets an MPOL_BIND policy for the whole pages in [addr, addr + len) so that they are
+// allocated on node when first touched (and moved there if they already exist). -1 does
+// nothing.
+inline bool BindToNode(void* addr, size_t len, int node) {
+  static const int kMpolBind = 2;
+  static const unsigned kMpolMfMove = 1 << 1;
+
+  if (node < 0 || len == 0) {
+    return true;
+  }
+  if (node >= 64) {
+    std::cerr << "mbind: node " << node << " out of range" << std::endl;
+    return false;
+  }
+
+  uintptr_t page = sysconf(_SC_PAGESIZE);
+  uintptr_t begin = (reinterpret_cast<uintptr_t>(addr) + page - 1) / page * page;
+  uintptr_t end = (reinterpret_cast<uintptr_t>(addr) + len) / page * page;
+  if (begin >= end) {
+    return true;  // smaller than a page: it lives wherever its neighbours do
+  }
+
+  unsigned long mask = 1ul << node;
+  if (syscall(SYS_mbind, begin, end - begin, kMpolBind, &mask, sizeof(mask) * 8 + 1, kMpolMfMove) != 0) {
+    std::cerr << "mbind to node " << node << ": " << std::strerror(errno) << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// Constructs a T on a short-lived thread pinned to cpu: memory that the constructor touches
+// (a std::vector ring, say) is first-touched, and so placed, on that CPU's node.
+template<class T, class... Args>
+std::unique_ptr<T> ConstructOnCpu(int cpu, Args&&... args) {
+  if (cpu < 0) {
+    return std::make_unique<T>(std::forward<Args>(args)...);
+  }
+  std::unique_ptr<T> result;
+  std::thread builder([&]() {
+    PinCurrentThread(cpu);
+    result = std::make_unique<T>(std::forward<Args>(args)...);
+  });
+  builder.join();
+  return result;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// Picks the producer batch size from the queue depth seen at each flush.
+//
+// Items held back in a batch wait no longer than items already queued when the batch is a
+// small fraction of the backlog, so the batch follows a quarter of the observed depth: a
+// consumer that keeps up (shallow queue) gets items one by one with minimal latency, and a
+// backlog lets both sides move big batches with one synchronization each. The batch moves by
+// doubling/halving to damp noise and stays within [min_batch, max_batch].
+class BatchTuner {
+ public:
+  BatchTuner(size_t min_batch = 1, size_t max_batch = 256)
+    : min_(std::max<size_t>(min_batch, 1))
+    , max_(std::max(min_, max_batch))
+    , batch_(min_) {}
+
+  size_t Batch() const {
+    return batch_;
+  }
+
+  void Observe(size_t depth) {
+    size_t target = std::clamp(depth / 4, min_, max_);
+    if (target >= batch_ * 2) {
+      batch_ *= 2;
+    } else if (target * 2 <= batch_) {
+      batch_ /= 2;
+    }
+  }
+
+ private:
+  size_t min_, max_;
+  size_t batch_;
+};
+
+// Collects pushes into batches for a Channel. Items wait in the local buffer until the batch
+// is full, so a producer that goes idle must Flush() first.
+template<typename T, class TChannel>
+class BatchingProducer {
+ public:
+  // batch == 0 turns on auto-tuning
+  BatchingProducer(TChannel& channel, size_t batch = 0, size_t max_batch = 256)
+    : channel_(channel)
+    , fixed_batch_(batch)
+    , tuner_(1, max_batch) {
+    buf_.reserve(std::max(batch, max_batch));
+  }
+
+  ~BatchingProducer() {
+    Flush();
+  }
+
+  // false if the channel is closed
+  bool Push(const T& item) {
+    buf_.push_back(item);
+    if (buf_.size() >= Batch()) {
+      return Flush();
+    }
+    return true;
+  }
+
+  bool Flush() {
+    if (buf_.empty()) {
+      return true;
+    }
+    if (!fixed_batch_) {
+      tuner_.Observe(channel_.Size());
+    }
+    bool ok = channel_.PushBulk(buf_) == buf_.size();
+    buf_.clear();
+    return ok;
+  }
+
+  size_t Batch() const {
+    return fixed_batch_ ? fixed_batch_ : tuner_.Batch();
+  }
+
+ private:
+  TChannel& channel_;
+  size_t fixed_batch_;
+  BatchTuner tuner_;
+  std::vector<T> buf_;
+};
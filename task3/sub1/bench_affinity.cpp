@@ -0,0 +1,117 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <string>
+#include <thread>
+
+#include "affinity.h"
+#include "channel.h"
+#include "spsc_queue.h"
+
+// Hand-off throughput by where the two threads run.
+//
+//   ./bench_affinity [--items N] [--capacity C]
+//
+// For each CPU relation that this machine offers (same CPU, SMT siblings, two cores of one
+// socket, two sockets) the producer and the consumer are pinned to a pair of CPUs in that
+// relation and the ring is first-touched on the consumer's node. Both the yielding SPSC ring
+// and the blocking channel are measured.
+
+using Clock = std::chrono::steady_clock;
+
+template<class TRun>
+double ItemsPerSec(long items, TRun&& run) {
+  auto t0 = Clock::now();
+  run();
+  return items / std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+double RunSpsc(int producer_cpu, int consumer_cpu, long items, size_t capacity) {
+  auto ring = ConstructOnCpu<SpscQueue<long>>(consumer_cpu, capacity);
+  return ItemsPerSec(items, [&]() {
+    std::thread consumer([&]() {
+      PinCurrentThread(consumer_cpu);
+      long v;
+      for (long i = 0; i < items; i++) {
+        while (!ring->TryPop(v)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+    PinCurrentThread(producer_cpu);
+    for (long i = 0; i < items; i++) {
+      while (!ring->TryPush(i)) {
+        std::this_thread::yield();
+      }
+    }
+    consumer.join();
+  });
+}
+
+double RunChannel(int producer_cpu, int consumer_cpu, long items, size_t capacity) {
+  auto channel = ConstructOnCpu<Channel<long>>(consumer_cpu, capacity);
+  return ItemsPerSec(items, [&]() {
+    std::thread consumer([&]() {
+      PinCurrentThread(consumer_cpu);
+      long v;
+      while (channel->Pop(v)) {
+      }
+    });
+    PinCurrentThread(producer_cpu);
+    for (long i = 0; i < items; i++) {
+      channel->Push(i);
+    }
+    channel->Close();
+    consumer.join();
+  });
+}
+
+int main(int argc, char** argv) {
+  long items = 2000000;
+  size_t capacity = 1024;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--items" && i + 1 < argc) {
+      items = std::atol(argv[++i]);
+    } else if (arg == "--capacity" && i + 1 < argc) {
+      capacity = std::atol(argv[++i]);
+    } else {
+      std::cerr << "usage: bench_affinity [--items N] [--capacity C]" << std::endl;
+      return 1;
+    }
+  }
+
+  CpuTopology topology = CpuTopology::Read();
+  std::set<int> sockets, nodes;
+  for (const auto& cpu: topology.Cpus()) {
+    sockets.insert(cpu.socket);
+    nodes.insert(cpu.node);
+  }
+  std::cout << topology.Cpus().size() << " cpus, " << sockets.size() << " sockets, "
+            << nodes.size() << " numa nodes" << std::endl;
+
+  std::cout << std::left << std::setw(14) << "relation" << std::right << std::setw(10) << "cpus"
+            << std::setw(16) << "spsc items/s" << std::setw(16) << "chan items/s" << std::endl;
+
+  for (CpuRelation r: {CpuRelation::SameCpu, CpuRelation::SmtSiblings, CpuRelation::SameSocket,
+                       CpuRelation::CrossSocket}) {
+    auto [p, c] = topology.FindPair(r);
+    std::cout << std::left << std::setw(14) << CpuRelationName(r) << std::right;
+    if (p < 0) {
+      std::cout << std::setw(10) << "n/a" << std::endl;
+      continue;
+    }
+    // run each pair on fresh threads: the main thread gets pinned as the producer
+    double spsc = 0, chan = 0;
+    std::thread([&]() {
+      spsc = RunSpsc(p, c, items, capacity);
+      chan = RunChannel(p, c, items, capacity);
+    }).join();
+    std::cout << std::setw(10) << (std::to_string(p) + "->" + std::to_string(c))
+              << std::setw(16) << uint64_t(spsc) << std::setw(16) << uint64_t(chan) << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,96 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "batch.h"
+#include "channel.h"
+
+// Channel throughput for per-item Push/Pop against PushBulk/PopBulk at fixed batch sizes and
+// with the auto-tuned batch.
+//
+//   ./bench_batch [num_items] [capacity]
+
+static const size_t kPopMax = 1024;
+
+struct Result {
+  double items_per_sec;
+  size_t final_batch;
+  bool ok;
+};
+
+Result RunPerItem(long num_items, size_t capacity) {
+  Channel<long> ch(capacity);
+  long sum = 0;
+
+  auto t0 = std::chrono::steady_clock::now();
+  std::thread consumer([&]() {
+    long v;
+    while (ch.Pop(v)) {
+      sum += v;
+    }
+  });
+  for (long i = 0; i < num_items; i++) {
+    ch.Push(i);
+  }
+  ch.Close();
+  consumer.join();
+  auto t1 = std::chrono::steady_clock::now();
+
+  return {num_items / std::chrono::duration<double>(t1 - t0).count(), 1,
+          sum == num_items * (num_items - 1) / 2};
+}
+
+Result RunBatched(long num_items, size_t capacity, size_t batch) {
+  Channel<long> ch(capacity);
+  long sum = 0;
+  size_t final_batch = 0;
+
+  auto t0 = std::chrono::steady_clock::now();
+  std::thread consumer([&]() {
+    std::vector<long> out(kPopMax);
+    while (size_t n = ch.PopBulk(out.data(), out.size())) {
+      for (size_t i = 0; i < n; i++) {
+        sum += out[i];
+      }
+    }
+  });
+  {
+    BatchingProducer<long, Channel<long>> producer(ch, batch);
+    for (long i = 0; i < num_items; i++) {
+      producer.Push(i);
+    }
+    producer.Flush();
+    final_batch = producer.Batch();
+  }
+  ch.Close();
+  consumer.join();
+  auto t1 = std::chrono::steady_clock::now();
+
+  return {num_items / std::chrono::duration<double>(t1 - t0).count(), final_batch,
+          sum == num_items * (num_items - 1) / 2};
+}
+
+void Print(const std::string& name, const Result& r) {
+  std::cout << std::setw(10) << name << std::setw(16) << r.items_per_sec << std::setw(8) << r.final_batch
+            << (r.ok ? "" : "  CHECKSUM MISMATCH") << std::endl;
+}
+
+int main(int argc, char** argv) {
+  long num_items = argc > 1 ? std::atol(argv[1]) : 2000000;
+  size_t capacity = argc > 2 ? std::atol(argv[2]) : 4096;
+
+  std::cout << "items: " << num_items << ", capacity: " << capacity << std::endl;
+  std::cout << std::setw(10) << "batch" << std::setw(16) << "items/s" << std::setw(8) << "final" << std::endl;
+
+  Print("per-item", RunPerItem(num_items, capacity));
+  for (size_t batch = 1; batch <= 1024; batch *= 4) {
+    Print(std::to_string(batch), RunBatched(num_items, capacity, batch));
+  }
+  Print("auto", RunBatched(num_items, capacity, 0));
+
+  return 0;
+}
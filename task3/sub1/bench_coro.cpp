@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "channel.h"
+#include "coro_channel.h"
+
+// Many concurrent streams: every stream is a channel with one producer and one consumer.
+//
+//   ./bench_coro [--channels N] [--items K] [--capacity C] [--threads T] [--thread-streams S]
+//
+// coroutines: 2N coroutines on T scheduler threads (default N = 10000)
+// threads:    S streams of blocking Channel<long> with one OS thread per side, for the
+//             per-item cost of the thread-per-consumer design (S is kept small: a thread
+//             per side does not stretch to 10k streams)
+
+struct Result {
+  double sec;
+  bool ok;
+};
+
+CoTask Produce(AsyncChannel<long>& ch, long items) {
+  for (long i = 0; i < items; i++) {
+    co_await ch.Send(i);
+  }
+  ch.Close();
+}
+
+CoTask Consume(AsyncChannel<long>& ch, std::atomic<long>& checksum) {
+  long sum = 0;
+  while (std::optional<long> v = co_await ch.Recv()) {
+    sum += *v;
+  }
+  checksum.fetch_add(sum, std::memory_order_relaxed);
+}
+
+Result RunCoroutines(unsigned threads, long channels, long items, size_t capacity) {
+  CoScheduler scheduler(threads);
+  std::vector<std::unique_ptr<AsyncChannel<long>>> chans;
+  for (long c = 0; c < channels; c++) {
+    chans.push_back(std::make_unique<AsyncChannel<long>>(scheduler, capacity));
+  }
+  std::atomic<long> checksum(0);
+
+  auto t0 = std::chrono::steady_clock::now();
+  for (long c = 0; c < channels; c++) {
+    scheduler.Spawn(Consume(*chans[c], checksum));
+    scheduler.Spawn(Produce(*chans[c], items));
+  }
+  scheduler.Join();
+  auto t1 = std::chrono::steady_clock::now();
+
+  return {std::chrono::duration<double>(t1 - t0).count(), checksum == channels * (items * (items - 1) / 2)};
+}
+
+Result RunThreads(long streams, long items, size_t capacity) {
+  std::vector<std::unique_ptr<Channel<long>>> chans;
+  for (long s = 0; s < streams; s++) {
+    chans.push_back(std::make_unique<Channel<long>>(capacity));
+  }
+  std::atomic<long> checksum(0);
+  std::vector<std::thread> threads;
+
+  auto t0 = std::chrono::steady_clock::now();
+  for (long s = 0; s < streams; s++) {
+    Channel<long>& ch = *chans[s];
+    threads.emplace_back([&ch, &checksum]() {
+      long sum = 0, v;
+      while (ch.Pop(v)) {
+        sum += v;
+      }
+      checksum.fetch_add(sum, std::memory_order_relaxed);
+    });
+    threads.emplace_back([&ch, items]() {
+      for (long i = 0; i < items; i++) {
+        ch.Push(i);
+      }
+      ch.Close();
+    });
+  }
+  for (auto& t: threads) {
+    t.join();
+  }
+  auto t1 = std::chrono::steady_clock::now();
+
+  return {std::chrono::duration<double>(t1 - t0).count(), checksum == streams * (items * (items - 1) / 2)};
+}
+
+int main(int argc, char** argv) {
+  long channels = 10000;
+  long items = 1000;
+  size_t capacity = 16;
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  long thread_streams = 64;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--channels" && i + 1 < argc) {
+      channels = std::atol(argv[++i]);
+    } else if (arg == "--items" && i + 1 < argc) {
+      items = std::atol(argv[++i]);
+    } else if (arg == "--capacity" && i + 1 < argc) {
+      capacity = std::atol(argv[++i]);
+    } else if (arg == "--threads" && i + 1 < argc) {
+      threads = std::atoi(argv[++i]);
+    } else if (arg == "--thread-streams" && i + 1 < argc) {
+      thread_streams = std::atol(argv[++i]);
+    } else {
+      std::cerr << "usage: bench_coro [--channels N] [--items K] [--capacity C] [--threads T]"
+                   " [--thread-streams S]" << std::endl;
+      return 1;
+    }
+  }
+
+  if (threads == 0) {
+    std::cerr << "need at least one scheduler thread" << std::endl;
+    return 1;
+  }
+
+  Result coro = RunCoroutines(threads, channels, items, capacity);
+  std::cout << "coroutines: " << channels << " channels x " << items << " items on " << threads
+            << " threads: " << coro.sec * 1e3 << " ms, " << channels * items / coro.sec << " items/s"
+            << (coro.ok ? "" : "  CHECKSUM MISMATCH") << std::endl;
+
+  Result thr = RunThreads(thread_streams, items, capacity);
+  std::cout << "threads:    " << thread_streams << " channels x " << items << " items on "
+            << 2 * thread_streams << " threads: " << thr.sec * 1e3 << " ms, "
+            << thread_streams * items / thr.sec << " items/s"
+            << (thr.ok ? "" : "  CHECKSUM MISMATCH") << std::endl;
+
+  return coro.ok && thr.ok ? 0 : 1;
+}
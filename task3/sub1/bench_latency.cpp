@@ -0,0 +1,46 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+#include "latency.h"
+
+// Producer/consumer hand-off through an InstrumentedChannel, reporting throughput and (in the
+// bench_latency build, with -DQUEUE_LATENCY_STATS) the hand-off latency histogram as JSON.
+// bench_latency_off is the same program without instrumentation, to measure its overhead.
+//
+//   ./bench_latency [num_items] [capacity]
+
+int main(int argc, char** argv) {
+  long num_items = argc > 1 ? std::atol(argv[1]) : 2000000;
+  size_t capacity = argc > 2 ? std::atol(argv[2]) : 1024;
+
+  InstrumentedChannel<long> ch(capacity);
+  long sum = 0;
+
+  auto t0 = std::chrono::steady_clock::now();
+  std::thread consumer([&]() {
+    long v;
+    while (ch.Pop(v)) {
+      sum += v;
+    }
+  });
+  for (long i = 0; i < num_items; i++) {
+    ch.Push(i);
+  }
+  ch.Close();
+  consumer.join();
+  auto t1 = std::chrono::steady_clock::now();
+
+  double sec = std::chrono::duration<double>(t1 - t0).count();
+#ifdef QUEUE_LATENCY_STATS
+  std::cout << "instrumented: ";
+#else
+  std::cout << "not instrumented: ";
+#endif
+  std::cout << num_items / sec << " items/s"
+            << (sum == num_items * (num_items - 1) / 2 ? "" : ", CHECKSUM MISMATCH") << std::endl;
+  std::cout << ch.StatsJson() << std::endl;
+
+  return 0;
+}
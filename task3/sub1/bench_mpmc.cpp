@@ -0,0 +1,149 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "locked_queue.h"
+#include "mpmc_queue.h"
+
+// Throughput of the bounded MPMC queue against a locked std::queue.
+//
+//   ./bench_mpmc [--producers N] [--consumers M] [--items K] [--capacity C] [--sweep]
+//
+// Producers push K items in total, consumers pop until they see one end marker each. With
+// --sweep the run is repeated for N = M = 1, 2, 4, ... up to the number of hardware threads.
+
+struct Result {
+  double items_per_sec;
+  bool ok;
+};
+
+template<class TQueue>
+Result Run(unsigned producers, unsigned consumers, long items, size_t capacity) {
+  TQueue queue(capacity);
+  std::atomic<long> checksum(0);
+  std::atomic<unsigned> ready(0);
+  std::atomic_bool go(false);
+
+  auto push = [&queue](long v) {
+    while (!queue.TryPush(v)) {
+      std::this_thread::yield();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned p = 0; p < producers; p++) {
+    threads.emplace_back([&, p]() {
+      ready++;
+      while (!go) {
+        std::this_thread::yield();
+      }
+      // producer p sends items p, p + producers, p + 2 * producers, ...
+      for (long v = p; v < items; v += producers) {
+        push(v);
+      }
+    });
+  }
+
+  for (unsigned c = 0; c < consumers; c++) {
+    threads.emplace_back([&]() {
+      ready++;
+      while (!go) {
+        std::this_thread::yield();
+      }
+      long sum = 0, v;
+      for (;;) {
+        if (!queue.TryPop(v)) {
+          std::this_thread::yield();
+          continue;
+        }
+        if (v < 0) {
+          break;
+        }
+        sum += v;
+      }
+      checksum += sum;
+    });
+  }
+
+  while (ready < producers + consumers) {
+    std::this_thread::yield();
+  }
+
+  auto t0 = std::chrono::steady_clock::now();
+  go = true;
+  for (unsigned p = 0; p < producers; p++) {
+    threads[p].join();
+  }
+  for (unsigned c = 0; c < consumers; c++) {
+    push(-1);
+  }
+  for (unsigned c = 0; c < consumers; c++) {
+    threads[producers + c].join();
+  }
+  auto t1 = std::chrono::steady_clock::now();
+
+  double sec = std::chrono::duration<double>(t1 - t0).count();
+  return {items / sec, checksum == items * (items - 1) / 2};
+}
+
+void Report(unsigned producers, unsigned consumers, long items, size_t capacity) {
+  Result mpmc = Run<MpmcQueue<long>>(producers, consumers, items, capacity);
+  Result locked = Run<LockedQueue<long>>(producers, consumers, items, capacity);
+
+  std::cout << std::setw(4) << producers << std::setw(4) << consumers
+            << std::setw(16) << mpmc.items_per_sec << std::setw(16) << locked.items_per_sec
+            << std::setw(10) << mpmc.items_per_sec / locked.items_per_sec
+            << ((mpmc.ok && locked.ok) ? "" : "  CHECKSUM MISMATCH") << std::endl;
+}
+
+int main(int argc, char** argv) {
+  unsigned producers = 1, consumers = 1;
+  long items = 1000000;
+  size_t capacity = 1024;
+  bool sweep = false;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--producers" && i + 1 < argc) {
+      producers = std::atoi(argv[++i]);
+    } else if (arg == "--consumers" && i + 1 < argc) {
+      consumers = std::atoi(argv[++i]);
+    } else if (arg == "--items" && i + 1 < argc) {
+      items = std::atol(argv[++i]);
+    } else if (arg == "--capacity" && i + 1 < argc) {
+      capacity = std::atol(argv[++i]);
+    } else if (arg == "--sweep") {
+      sweep = true;
+    } else {
+      std::cerr << "usage: bench_mpmc [--producers N] [--consumers M] [--items K] [--capacity C] [--sweep]"
+                << std::endl;
+      return 1;
+    }
+  }
+
+  if (producers == 0 || consumers == 0) {
+    std::cerr << "need at least one producer and one consumer" << std::endl;
+    return 1;
+  }
+
+  std::cout << "items: " << items << ", capacity: " << capacity
+            << ", hardware threads: " << std::thread::hardware_concurrency() << std::endl;
+  std::cout << std::setw(4) << "P" << std::setw(4) << "C" << std::setw(16) << "mpmc items/s"
+            << std::setw(16) << "locked items/s" << std::setw(10) << "speedup" << std::endl;
+
+  if (sweep) {
+    unsigned max_threads = std::max(2u, std::thread::hardware_concurrency());
+    for (unsigned n = 1; n * 2 <= max_threads; n *= 2) {
+      Report(n, n, items, capacity);
+    }
+  } else {
+    Report(producers, consumers, items, capacity);
+  }
+
+  return 0;
+}
@@ -0,0 +1,207 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "thread_pool.h"
+
+// Task throughput of the work-stealing pool against a pool fed by one shared locked queue
+// (the original producer/consumer design).
+//
+//   ./bench_pool [--threads N] [--tasks K] [--fib F]
+//
+// tiny:  the main thread spawns K empty tasks and waits for them
+// fib:   naive fork-join fib(F), one task per call above a small cutoff
+// for:   ParallelFor over K elements with a grain of 1024
+
+// One std::deque under one mutex; every spawn and every take goes through the lock.
+class SharedQueuePool {
+ public:
+  explicit SharedQueuePool(unsigned threads) {
+    for (unsigned i = 0; i < threads; i++) {
+      threads_.emplace_back([this]() { WorkerLoop(); });
+    }
+  }
+
+  ~SharedQueuePool() {
+    {
+      std::lock_guard<std::mutex> g(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto& t: threads_) {
+      t.join();
+    }
+  }
+
+  void Spawn(Task task) {
+    {
+      std::lock_guard<std::mutex> g(mutex_);
+      tasks_.push_back(std::move(task));
+    }
+    cv_.notify_one();
+  }
+
+  bool TryRunOne() {
+    Task task;
+    {
+      std::lock_guard<std::mutex> g(mutex_);
+      if (tasks_.empty()) {
+        return false;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+    return true;
+  }
+
+  template<class F>
+  void ParallelFor(size_t begin, size_t end, size_t grain, F&& f) {
+    TaskGroup<SharedQueuePool> group(*this);
+    ParallelForSplit(group, begin, end, grain, f);
+    group.Wait();
+  }
+
+ private:
+  void WorkerLoop() {
+    for (;;) {
+      Task task;
+      {
+        std::unique_lock<std::mutex> ul(mutex_);
+        cv_.wait(ul, [this]() { return stop_ || !tasks_.empty(); });
+        if (tasks_.empty()) {
+          return;
+        }
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+      task();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Task> tasks_;
+  bool stop_ = false;
+  std::vector<std::thread> threads_;
+};
+
+static const long kFibCutoff = 12;
+
+static long SerialFib(long n) {
+  return n < 2 ? n : SerialFib(n - 1) + SerialFib(n - 2);
+}
+
+template<class TPool>
+long Fib(TPool& pool, long n) {
+  if (n < kFibCutoff) {
+    return SerialFib(n);
+  }
+  long a = 0;
+  TaskGroup<TPool> group(pool);
+  group.Spawn([&pool, &a, n]() { a = Fib(pool, n - 1); });
+  long b = Fib(pool, n - 2);
+  group.Wait();
+  return a + b;
+}
+
+template<class F>
+double Seconds(F&& f) {
+  auto t0 = std::chrono::steady_clock::now();
+  f();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+struct Result {
+  double tiny_per_sec;
+  double fib_sec;
+  double for_sec;
+  bool ok;
+};
+
+template<class TPool>
+Result Run(unsigned threads, long tasks, long fib) {
+  TPool pool(threads);
+  Result r{};
+  r.ok = true;
+
+  std::atomic<long> done(0);
+  double sec = Seconds([&]() {
+    TaskGroup<TPool> group(pool);
+    for (long i = 0; i < tasks; i++) {
+      group.Spawn([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+    }
+    group.Wait();
+  });
+  r.tiny_per_sec = tasks / sec;
+  r.ok &= done == tasks;
+
+  long value = 0;
+  r.fib_sec = Seconds([&]() { value = Fib(pool, fib); });
+  r.ok &= value == SerialFib(fib);
+
+  std::vector<long> data(tasks, 1);
+  r.for_sec = Seconds([&]() {
+    pool.ParallelFor(0, data.size(), 1024, [&data](size_t i) { data[i] = data[i] * 3 + long(i); });
+  });
+  for (long i = 0; i < tasks; i++) {
+    r.ok &= data[i] == 3 + i;
+  }
+
+  return r;
+}
+
+int main(int argc, char** argv) {
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  long tasks = 1000000;
+  long fib = 30;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--threads" && i + 1 < argc) {
+      threads = std::atoi(argv[++i]);
+    } else if (arg == "--tasks" && i + 1 < argc) {
+      tasks = std::atol(argv[++i]);
+    } else if (arg == "--fib" && i + 1 < argc) {
+      fib = std::atol(argv[++i]);
+    } else {
+      std::cerr << "usage: bench_pool [--threads N] [--tasks K] [--fib F]" << std::endl;
+      return 1;
+    }
+  }
+
+  if (threads == 0) {
+    std::cerr << "need at least one thread" << std::endl;
+    return 1;
+  }
+
+  Result stealing = Run<WorkStealingPool>(threads, tasks, fib);
+  Result shared = Run<SharedQueuePool>(threads, tasks, fib);
+
+  std::cout << "threads: " << threads << ", tasks: " << tasks << ", fib: " << fib << std::endl;
+  std::cout << std::setw(14) << "" << std::setw(16) << "stealing" << std::setw(16) << "shared"
+            << std::setw(10) << "speedup" << std::endl;
+  std::cout << std::setw(14) << "tiny tasks/s" << std::setw(16) << stealing.tiny_per_sec
+            << std::setw(16) << shared.tiny_per_sec << std::setw(10)
+            << stealing.tiny_per_sec / shared.tiny_per_sec << std::endl;
+  std::cout << std::setw(14) << "fib s" << std::setw(16) << stealing.fib_sec
+            << std::setw(16) << shared.fib_sec << std::setw(10) << shared.fib_sec / stealing.fib_sec
+            << std::endl;
+  std::cout << std::setw(14) << "for s" << std::setw(16) << stealing.for_sec
+            << std::setw(16) << shared.for_sec << std::setw(10) << shared.for_sec / stealing.for_sec
+            << std::endl;
+
+  if (!stealing.ok || !shared.ok) {
+    std::cout << "RESULT MISMATCH" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,192 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "channel.h"
+#include "shm_queue.h"
+
+// Cross-process hand-off: the shared-memory queue against the in-process channel and a Unix
+// domain socket pair.
+//
+//   ./bench_shm [--items N] [--capacity C] [--crash]
+//
+// The consumer process is forked from the producer and sums what it receives; the checksum
+// comes back through its exit status. With --crash the consumer dies halfway and the run
+// reports how long the producer takes to notice.
+
+using Clock = std::chrono::steady_clock;
+
+static const char* kSegment = "/bench_shm_queue";
+
+static void Report(const std::string& name, long items, Clock::time_point t0, bool ok) {
+  double sec = std::chrono::duration<double>(Clock::now() - t0).count();
+  std::cout << name << ": " << items << " items in " << sec * 1e3 << " ms, " << items / sec
+            << " items/s" << (ok ? "" : "  CHECKSUM MISMATCH") << std::endl;
+}
+
+// the low byte of the checksum is enough to catch a lost or doubled item
+static int ChecksumByte(long items) {
+  return int((items * (items - 1) / 2) & 0xff);
+}
+
+static bool WaitChild(pid_t pid, long items) {
+  int status = 0;
+  waitpid(pid, &status, 0);
+  return WIFEXITED(status) && WEXITSTATUS(status) == ChecksumByte(items);
+}
+
+void RunChannel(long items, size_t capacity) {
+  Channel<long> ch(capacity);
+  long sum = 0;
+  auto t0 = Clock::now();
+  std::thread consumer([&]() {
+    long v;
+    while (ch.Pop(v)) {
+      sum += v;
+    }
+  });
+  for (long i = 0; i < items; i++) {
+    ch.Push(i);
+  }
+  ch.Close();
+  consumer.join();
+  Report("in-process channel", items, t0, (sum & 0xff) == ChecksumByte(items));
+}
+
+void RunShm(long items, size_t capacity) {
+  auto producer = ShmQueue<long>::Create(kSegment, capacity, ShmQueue<long>::Role::Producer);
+  if (!producer) {
+    return;
+  }
+
+  auto t0 = Clock::now();
+  pid_t pid = fork();
+  if (pid == 0) {
+    auto consumer = ShmQueue<long>::Open(kSegment, ShmQueue<long>::Role::Consumer);
+    if (!consumer) {
+      _exit(255);
+    }
+    long sum = 0, v;
+    while (consumer->Pop(v)) {
+      sum += v;
+    }
+    _exit(int(sum & 0xff));
+  }
+
+  for (long i = 0; i < items; i++) {
+    producer->Push(i);
+  }
+  producer->Close();
+  bool ok = WaitChild(pid, items);
+  ShmQueue<long>::Unlink(kSegment);
+  Report("shm queue (fork)  ", items, t0, ok);
+}
+
+void RunSocket(long items) {
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+    std::cerr << "socketpair failed" << std::endl;
+    return;
+  }
+
+  auto t0 = Clock::now();
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    long sum = 0, v;
+    size_t got = 0;
+    char* p = reinterpret_cast<char*>(&v);
+    for (;;) {
+      ssize_t n = read(fds[1], p + got, sizeof(v) - got);
+      if (n <= 0) {
+        break;
+      }
+      got += n;
+      if (got == sizeof(v)) {
+        sum += v;
+        got = 0;
+      }
+    }
+    _exit(int(sum & 0xff));
+  }
+
+  close(fds[1]);
+  for (long i = 0; i < items; i++) {
+    if (write(fds[0], &i, sizeof(i)) != sizeof(i)) {
+      break;
+    }
+  }
+  close(fds[0]);
+  bool ok = WaitChild(pid, items);
+  Report("unix socketpair   ", items, t0, ok);
+}
+
+void RunCrash(long items, size_t capacity) {
+  auto producer = ShmQueue<long>::Create(kSegment, capacity, ShmQueue<long>::Role::Producer);
+  if (!producer) {
+    return;
+  }
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    auto consumer = ShmQueue<long>::Open(kSegment, ShmQueue<long>::Role::Consumer);
+    long v;
+    for (long i = 0; consumer && i < items / 2; i++) {
+      consumer->Pop(v);
+    }
+    _exit(0);  // without Close(): as good as a crash for the producer
+  }
+
+  long pushed = 0;
+  Clock::time_point last_ok = Clock::now();
+  for (long i = 0; i < items; i++) {
+    if (!producer->Push(i)) {
+      break;
+    }
+    last_ok = Clock::now();
+    pushed++;
+  }
+  double ms = std::chrono::duration<double, std::milli>(Clock::now() - last_ok).count();
+  waitpid(pid, nullptr, 0);
+  ShmQueue<long>::Unlink(kSegment);
+
+  std::cout << "crash: consumer died after " << items / 2 << " items, producer pushed " << pushed
+            << " and noticed " << ms << " ms after its last successful push" << std::endl;
+}
+
+int main(int argc, char** argv) {
+  long items = 1000000;
+  size_t capacity = 1024;
+  bool crash = false;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--items" && i + 1 < argc) {
+      items = std::atol(argv[++i]);
+    } else if (arg == "--capacity" && i + 1 < argc) {
+      capacity = std::atol(argv[++i]);
+    } else if (arg == "--crash") {
+      crash = true;
+    } else {
+      std::cerr << "usage: bench_shm [--items N] [--capacity C] [--crash]" << std::endl;
+      return 1;
+    }
+  }
+
+  if (crash) {
+    RunCrash(items, capacity);
+    return 0;
+  }
+
+  RunChannel(items, capacity);
+  RunShm(items, capacity);
+  RunSocket(items);
+  return 0;
+}
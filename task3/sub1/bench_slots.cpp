@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "locked_queue.h"
+#include "slot_ring.h"
+
+// Large messages: the zero-copy slot ring against a queue that copies them by value.
+//
+//   ./bench_slots [--megabytes M] [--slots S]
+//
+// For every payload size from 8 B to 64 KB the producer writes M megabytes worth of messages
+// and the consumer reads every byte of each one.
+//
+// copied:  std::vector<char> messages through the original std::queue under a mutex; each
+//          message is built in a fresh vector, copied into the queue and copied out
+// slots:   built and read in place in a preallocated SlotRing
+
+using Clock = std::chrono::steady_clock;
+
+static void Fill(char* p, size_t n, uint64_t seed) {
+  for (size_t i = 0; i < n; i += 8) {
+    uint64_t v = seed + i;
+    std::memcpy(p + i, &v, std::min<size_t>(8, n - i));
+  }
+}
+
+static uint64_t Sum(const char* p, size_t n) {
+  uint64_t s = 0;
+  for (size_t i = 0; i < n; i += 8) {
+    uint64_t v = 0;
+    std::memcpy(&v, p + i, std::min<size_t>(8, n - i));
+    s += v;
+  }
+  return s;
+}
+
+struct Result {
+  double sec;
+  uint64_t checksum;
+};
+
+Result RunCopied(size_t size, long messages, size_t capacity) {
+  LockedQueue<std::vector<char>> queue(capacity);
+  uint64_t checksum = 0;
+  auto t0 = Clock::now();
+
+  std::thread consumer([&]() {
+    std::vector<char> msg;
+    for (long i = 0; i < messages; i++) {
+      while (!queue.TryPop(msg)) {
+        std::this_thread::yield();
+      }
+      checksum += Sum(msg.data(), msg.size());
+    }
+  });
+
+  for (long i = 0; i < messages; i++) {
+    std::vector<char> msg(size);
+    Fill(msg.data(), size, i);
+    while (!queue.TryPush(msg)) {
+      std::this_thread::yield();
+    }
+  }
+  consumer.join();
+
+  return {std::chrono::duration<double>(Clock::now() - t0).count(), checksum};
+}
+
+Result RunSlots(size_t size, long messages, size_t capacity) {
+  SlotRing ring(capacity, size);
+  uint64_t checksum = 0;
+  auto t0 = Clock::now();
+
+  std::thread consumer([&]() {
+    std::span<const std::byte> msg;
+    while (ring.Acquire(msg)) {
+      checksum += Sum(reinterpret_cast<const char*>(msg.data()), msg.size());
+      ring.Release();
+    }
+  });
+
+  for (long i = 0; i < messages; i++) {
+    std::span<std::byte> slot = ring.Reserve();
+    Fill(reinterpret_cast<char*>(slot.data()), size, i);
+    ring.Commit(size);
+  }
+  ring.Close();
+  consumer.join();
+
+  return {std::chrono::duration<double>(Clock::now() - t0).count(), checksum};
+}
+
+int main(int argc, char** argv) {
+  long megabytes = 256;
+  size_t slots = 64;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--megabytes" && i + 1 < argc) {
+      megabytes = std::atol(argv[++i]);
+    } else if (arg == "--slots" && i + 1 < argc) {
+      slots = std::atol(argv[++i]);
+    } else {
+      std::cerr << "usage: bench_slots [--megabytes M] [--slots S]" << std::endl;
+      return 1;
+    }
+  }
+
+  std::cout << std::setw(8) << "size" << std::setw(10) << "messages" << std::setw(14) << "copied MB/s"
+            << std::setw(14) << "slots MB/s" << std::setw(10) << "speedup" << std::endl;
+
+  for (size_t size: {8, 64, 512, 4096, 16384, 65536}) {
+    long messages = std::min<long>(megabytes * (1 << 20) / size, 2000000);
+    double mb = double(messages) * size / (1 << 20);
+
+    Result copied = RunCopied(size, messages, slots);
+    Result slotted = RunSlots(size, messages, slots);
+
+    bool ok = copied.checksum == slotted.checksum;
+    std::cout << std::setw(8) << size << std::setw(10) << messages
+              << std::setw(14) << std::fixed << std::setprecision(0) << mb / copied.sec
+              << std::setw(14) << mb / slotted.sec << std::setw(10) << std::setprecision(2)
+              << copied.sec / slotted.sec
+              << (ok ? "" : "  CHECKSUM MISMATCH") << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "channel.h"
+
+// Wake-up latency: time from a push into an empty queue to the moment an idle consumer holds
+// the item. The producer sends one timestamped item, then pauses so the consumer goes idle
+// again (spinning, yielding or parked, depending on the pause).
+//
+//   ./bench_wakeup [num_items] [pause_us]
+//
+// "polling" is the original loop: wait_for(1ms) on a condition variable, drain, repeat.
+
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+
+static long NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+static void Report(const std::string& name, std::vector<long>& lat) {
+  std::sort(lat.begin(), lat.end());
+  auto pct = [&](double q) { return lat[size_t(q * (lat.size() - 1))] / 1000.0; };
+  std::cout << name << ": p50 " << pct(0.5) << " us, p99 " << pct(0.99) << " us, max "
+            << lat.back() / 1000.0 << " us" << std::endl;
+}
+
+std::vector<long> RunPolling(int num_items, int pause_us) {
+  std::vector<long> lat;
+  std::queue<long> items;
+  std::mutex items_mutex;
+  std::condition_variable push_cv;
+  std::atomic_bool done(false);
+
+  std::thread consumer([&]() {
+    while (!done) {
+      std::unique_lock<std::mutex> ul(items_mutex);
+      push_cv.wait_for(ul, 1ms);
+      while (!items.empty()) {
+        lat.push_back(NowNs() - items.front());
+        items.pop();
+      }
+    }
+  });
+
+  for (int i = 0; i < num_items; i++) {
+    std::this_thread::sleep_for(std::chrono::microseconds(pause_us));
+    {
+      std::lock_guard<std::mutex> g(items_mutex);
+      items.push(NowNs());
+    }
+    push_cv.notify_all();
+  }
+
+  std::this_thread::sleep_for(2ms);
+  done = true;
+  consumer.join();
+  return lat;
+}
+
+std::vector<long> RunChannel(int num_items, int pause_us) {
+  std::vector<long> lat;
+  Channel<long> items(1024);
+
+  std::thread consumer([&]() {
+    long ts;
+    while (items.Pop(ts)) {
+      lat.push_back(NowNs() - ts);
+    }
+  });
+
+  for (int i = 0; i < num_items; i++) {
+    std::this_thread::sleep_for(std::chrono::microseconds(pause_us));
+    items.Push(NowNs());
+  }
+
+  auto t0 = Clock::now();
+  items.Close();
+  consumer.join();
+  auto t1 = Clock::now();
+  std::cout << "channel shutdown: " << std::chrono::duration<double, std::micro>(t1 - t0).count()
+            << " us" << std::endl;
+  return lat;
+}
+
+int main(int argc, char** argv) {
+  int num_items = argc > 1 ? std::atoi(argv[1]) : 2000;
+  int pause_us = argc > 2 ? std::atoi(argv[2]) : 200;
+
+  std::cout << "items: " << num_items << ", pause: " << pause_us << " us" << std::endl;
+
+  std::vector<long> polling = RunPolling(num_items, pause_us);
+  std::vector<long> channel = RunChannel(num_items, pause_us);
+
+  Report("polling (wait_for 1ms)", polling);
+  Report("adaptive channel      ", channel);
+
+  return 0;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <cstddef>
+
+// destructive interference size; fields written by different threads are kept this far apart
+static const size_t kCacheLine = 64;
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <span>
+
+#include "spsc_queue.h"
+#include "waiter.h"
+
+// Blocking, closable channel over one of the bounded TryPush/TryPop queues.
+//
+// Push() waits while the queue is full and Pop() waits while it is empty, both through an
+// AdaptiveWaiter. Close() is the shutdown handshake: it wakes every waiter at once, further
+// pushes fail, and consumers drain whatever is still queued before Pop() returns false. There
+// is no polling on either side.
+//
+// PushBulk()/PopBulk() move a whole batch per queue operation and wake the other side once
+// per batch; they need a queue with TryPushBulk/TryPopBulk.
+//
+// The queue type decides how many threads may push and pop (SpscQueue: one each).
+template<typename T, class TQueue = SpscQueue<T>>
+class Channel {
+ public:
+  explicit Channel(size_t capacity) : queue_(capacity) {}
+
+  // false if the channel is closed; the item is not queued then
+  bool Push(const T& item) {
+    bool pushed = false;
+    not_full_.Wait([&]() {
+      return (pushed = queue_.TryPush(item)) || closed_.load(std::memory_order_acquire);
+    });
+    if (pushed) {
+      not_empty_.NotifyOne();
+    }
+    return pushed;
+  }
+
+  // false once the channel is closed and drained
+  bool Pop(T& item) {
+    bool popped = false;
+    not_empty_.Wait([&]() {
+      return (popped = queue_.TryPop(item)) || closed_.load(std::memory_order_acquire);
+    });
+    if (!popped) {
+      // closed: the producer may have pushed right before closing
+      popped = queue_.TryPop(item);
+    }
+    if (popped) {
+      not_full_.NotifyOne();
+    }
+    return popped;
+  }
+
+  // Pushes all items, waiting for room as needed; returns fewer than items.size() only if the
+  // channel was closed. Every chunk that fits is published and signalled once.
+  size_t PushBulk(std::span<const T> items) {
+    size_t done = 0;
+    while (done < items.size()) {
+      size_t n = 0;
+      not_full_.Wait([&]() {
+        return (n = queue_.TryPushBulk(items.subspan(done))) > 0 || closed_.load(std::memory_order_acquire);
+      });
+      if (n == 0) {
+        break;
+      }
+      done += n;
+      not_empty_.NotifyOne();
+    }
+    return done;
+  }
+
+  // Waits for at least one item and pops up to max; returns 0 once closed and drained.
+  size_t PopBulk(T* out, size_t max) {
+    size_t n = 0;
+    not_empty_.Wait([&]() {
+      return (n = queue_.TryPopBulk(out, max)) > 0 || closed_.load(std::memory_order_acquire);
+    });
+    if (n == 0) {
+      n = queue_.TryPopBulk(out, max);
+    }
+    if (n > 0) {
+      not_full_.NotifyOne();
+    }
+    return n;
+  }
+
+  bool TryPush(const T& item) {
+    if (closed_.load(std::memory_order_acquire) || !queue_.TryPush(item)) {
+      return false;
+    }
+    not_empty_.NotifyOne();
+    return true;
+  }
+
+  bool TryPop(T& item) {
+    if (!queue_.TryPop(item)) {
+      return false;
+    }
+    not_full_.NotifyOne();
+    return true;
+  }
+
+  void Close() {
+    closed_.store(true, std::memory_order_release);
+    not_empty_.NotifyAll();
+    not_full_.NotifyAll();
+  }
+
+  bool Closed() const {
+    return closed_.load(std::memory_order_acquire);
+  }
+
+  size_t Size() const {
+    return queue_.Size();
+  }
+
+ private:
+  TQueue queue_;
+  std::atomic_bool closed_{false};
+  AdaptiveWaiter not_empty_;
+  AdaptiveWaiter not_full_;
+};
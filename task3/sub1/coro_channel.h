@@ -0,0 +1,340 @@
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#include "thread_pool.h"
+
+// Coroutine producers and consumers on a fixed set of threads.
+//
+// A CoTask is a fire-and-forget coroutine; CoScheduler::Spawn() starts it on a
+// WorkStealingPool and Join() waits until every spawned coroutine has returned. A coroutine
+// blocked on an AsyncChannel costs its frame and nothing else, so thousands of logical
+// streams fit on a handful of threads:
+//
+//   CoTask Producer(AsyncChannel<int>& ch) {
+//     for (int i = 0; i < 100; i++) {
+//       co_await ch.Send(i);
+//     }
+//     ch.Close();
+//   }
+//
+//   CoTask Consumer(AsyncChannel<int>& ch) {
+//     while (std::optional<int> v = co_await ch.Recv()) {
+//       ...
+//     }
+//   }
+
+class CoScheduler;
+
+class CoTask {
+ public:
+  struct promise_type {
+    CoTask get_return_object() {
+      return CoTask(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    // nothing runs until the task is spawned
+    std::suspend_always initial_suspend() noexcept {
+      return {};
+    }
+    // the frame frees itself when the body returns
+    std::suspend_never final_suspend() noexcept;
+    void return_void() {}
+    void unhandled_exception() {
+      std::terminate();
+    }
+
+    CoScheduler* scheduler = nullptr;
+  };
+
+  CoTask(CoTask&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+  CoTask(const CoTask&) = delete;
+  CoTask& operator=(const CoTask&) = delete;
+
+  // a task that was never spawned is simply dropped
+  ~CoTask() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+ private:
+  friend class CoScheduler;
+
+  explicit CoTask(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+class CoScheduler {
+ public:
+  // 0 threads: one per hardware thread
+  explicit CoScheduler(unsigned threads = 0) : pool_(threads) {}
+
+  ~CoScheduler() {
+    Join();
+  }
+
+  CoScheduler(const CoScheduler&) = delete;
+  CoScheduler& operator=(const CoScheduler&) = delete;
+
+  // may be called from inside a coroutine
+  void Spawn(CoTask task) {
+    auto handle = std::exchange(task.handle_, {});
+    handle.promise().scheduler = this;
+    live_.fetch_add(1, std::memory_order_relaxed);
+    Schedule(handle);
+  }
+
+  // queues a suspended coroutine to be resumed on one of the threads
+  void Schedule(std::coroutine_handle<> handle) {
+    pool_.Spawn([handle]() { handle.resume(); });
+  }
+
+  // blocks until every spawned coroutine has finished
+  void Join() {
+    size_t n;
+    while ((n = live_.load(std::memory_order_acquire)) != 0) {
+      live_.wait(n, std::memory_order_acquire);
+    }
+  }
+
+  unsigned Threads() const {
+    return pool_.Size();
+  }
+
+ private:
+  friend struct CoTask::promise_type;
+
+  void Finished() {
+    if (live_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      live_.notify_all();
+    }
+  }
+
+  // declared first so that the workers, which may still be inside Finished(), are joined
+  // before it goes away
+  std::atomic<size_t> live_{0};
+  WorkStealingPool pool_;
+};
+
+inline std::suspend_never CoTask::promise_type::final_suspend() noexcept {
+  if (scheduler) {
+    scheduler->Finished();
+  }
+  return {};
+}
+
+// Bounded, closable multi-producer/multi-consumer channel for coroutines.
+//
+// co_await Send(x) completes at once if a receiver is waiting (the value is handed to it
+// directly) or the buffer has room, and suspends the sender otherwise; co_await Recv() is the
+// mirror image. Waiters queue in FIFO order on intrusive lists threaded through their
+// awaiters, which live in the suspended coroutine frames, so waiting allocates nothing.
+// Woken coroutines are resumed through the scheduler, never inline, so a long ping-pong does
+// not grow the stack. Capacity 0 makes every Send a rendezvous.
+//
+// Close() fails pending and later sends (Send yields false); receivers drain the buffer and
+// then get std::nullopt.
+template<typename T>
+class AsyncChannel {
+ public:
+  class SendAwaiter {
+   public:
+    bool await_ready() const noexcept {
+      return false;
+    }
+    bool await_suspend(std::coroutine_handle<> handle) {
+      return channel_.SuspendSend(*this, handle);
+    }
+    // false if the channel was closed and the value dropped
+    bool await_resume() const noexcept {
+      return ok_;
+    }
+
+   private:
+    friend class AsyncChannel;
+
+    SendAwaiter(AsyncChannel& channel, T value) : channel_(channel), value_(std::move(value)) {}
+
+    AsyncChannel& channel_;
+    T value_;
+    std::coroutine_handle<> handle_;
+    SendAwaiter* next_ = nullptr;
+    bool ok_ = false;
+  };
+
+  class RecvAwaiter {
+   public:
+    bool await_ready() const noexcept {
+      return false;
+    }
+    bool await_suspend(std::coroutine_handle<> handle) {
+      return channel_.SuspendRecv(*this, handle);
+    }
+    // std::nullopt once the channel is closed and drained
+    std::optional<T> await_resume() {
+      return std::move(value_);
+    }
+
+   private:
+    friend class AsyncChannel;
+
+    explicit RecvAwaiter(AsyncChannel& channel) : channel_(channel) {}
+
+    AsyncChannel& channel_;
+    std::optional<T> value_;
+    std::coroutine_handle<> handle_;
+    RecvAwaiter* next_ = nullptr;
+  };
+
+  AsyncChannel(CoScheduler& scheduler, size_t capacity)
+    : scheduler_(scheduler)
+    , capacity_(capacity) {}
+
+  AsyncChannel(const AsyncChannel&) = delete;
+  AsyncChannel& operator=(const AsyncChannel&) = delete;
+
+  SendAwaiter Send(T value) {
+    return SendAwaiter(*this, std::move(value));
+  }
+
+  RecvAwaiter Recv() {
+    return RecvAwaiter(*this);
+  }
+
+  void Close() {
+    SendAwaiter* senders;
+    RecvAwaiter* receivers;
+    {
+      std::lock_guard<std::mutex> g(mutex_);
+      closed_ = true;
+      senders = std::exchange(senders_.head, nullptr);
+      receivers = std::exchange(receivers_.head, nullptr);
+      senders_.tail = nullptr;
+      receivers_.tail = nullptr;
+    }
+    // read next_ before scheduling: a resumed coroutine may free its awaiter right away
+    while (senders) {
+      SendAwaiter* next = senders->next_;
+      senders->ok_ = false;
+      scheduler_.Schedule(senders->handle_);
+      senders = next;
+    }
+    while (receivers) {
+      RecvAwaiter* next = receivers->next_;
+      scheduler_.Schedule(receivers->handle_);
+      receivers = next;
+    }
+  }
+
+  bool Closed() const {
+    std::lock_guard<std::mutex> g(mutex_);
+    return closed_;
+  }
+
+  size_t Size() const {
+    std::lock_guard<std::mutex> g(mutex_);
+    return buffer_.size();
+  }
+
+ private:
+  template<class TAwaiter>
+  struct WaitList {
+    void Push(TAwaiter* a) {
+      a->next_ = nullptr;
+      if (tail) {
+        tail->next_ = a;
+      } else {
+        head = a;
+      }
+      tail = a;
+    }
+
+    TAwaiter* Pop() {
+      TAwaiter* a = head;
+      if (a) {
+        head = a->next_;
+        if (!head) {
+          tail = nullptr;
+        }
+      }
+      return a;
+    }
+
+    TAwaiter* head = nullptr;
+    TAwaiter* tail = nullptr;
+  };
+
+  // true: the sender stays suspended until a receiver or Close() schedules it
+  bool SuspendSend(SendAwaiter& a, std::coroutine_handle<> handle) {
+    std::unique_lock<std::mutex> ul(mutex_);
+    if (closed_) {
+      return false;
+    }
+
+    if (RecvAwaiter* r = receivers_.Pop()) {
+      r->value_.emplace(std::move(a.value_));
+      a.ok_ = true;
+      ul.unlock();
+      scheduler_.Schedule(r->handle_);
+      return false;
+    }
+
+    if (buffer_.size() < capacity_) {
+      buffer_.push_back(std::move(a.value_));
+      a.ok_ = true;
+      return false;
+    }
+
+    // once the lock is released another thread may resume the coroutine: touch nothing after
+    a.handle_ = handle;
+    senders_.Push(&a);
+    return true;
+  }
+
+  bool SuspendRecv(RecvAwaiter& a, std::coroutine_handle<> handle) {
+    std::unique_lock<std::mutex> ul(mutex_);
+    SendAwaiter* s = senders_.Pop();
+
+    if (!buffer_.empty()) {
+      a.value_.emplace(std::move(buffer_.front()));
+      buffer_.pop_front();
+      if (s) {
+        // the freed slot goes to the longest-waiting sender
+        buffer_.push_back(std::move(s->value_));
+      }
+    } else if (s) {
+      // unbuffered: take the value straight from the sender
+      a.value_.emplace(std::move(s->value_));
+    } else if (closed_) {
+      return false;
+    } else {
+      a.handle_ = handle;
+      receivers_.Push(&a);
+      return true;
+    }
+
+    if (s) {
+      s->ok_ = true;
+      ul.unlock();
+      scheduler_.Schedule(s->handle_);
+    }
+    return false;
+  }
+
+  CoScheduler& scheduler_;
+  const size_t capacity_;
+
+  mutable std::mutex mutex_;
+  std::deque<T> buffer_;
+  WaitList<SendAwaiter> senders_;
+  WaitList<RecvAwaiter> receivers_;
+  bool closed_ = false;
+};
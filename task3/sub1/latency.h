@@ -0,0 +1,308 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "channel.h"
+
+// Hand-off latency instrumentation for the queues.
+//
+// Everything here is compiled in only with -DQUEUE_LATENCY_STATS. Without it
+// InstrumentedChannel<T> is a plain Channel<T> and StatsJson() reports nothing, so instrumented
+// code costs nothing in a normal build.
+
+// Cheap timestamps: the TSC on x86 (invariant on every CPU made in the last decade),
+// steady_clock elsewhere. Ticks are converted to nanoseconds only when reporting.
+class TickClock {
+ public:
+  static uint64_t Now() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+  }
+
+  static double NsPerTick() {
+    static const double ns_per_tick = Calibrate();
+    return ns_per_tick;
+  }
+
+ private:
+  static double Calibrate() {
+#if defined(__x86_64__) || defined(__i386__)
+    auto t0 = std::chrono::steady_clock::now();
+    uint64_t c0 = __rdtsc();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    auto t1 = std::chrono::steady_clock::now();
+    uint64_t c1 = __rdtsc();
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() / double(c1 - c0);
+#else
+    return 1.0;
+#endif
+  }
+};
+
+// Log-linear histogram in the style of HdrHistogram: values below 2^kSubBits are exact, above
+// that every power of two is split into 2^kSubBits buckets, so any recorded value is known to
+// within ~3%. Recording is a count-leading-zeros and an increment.
+//
+// One thread records; any thread may read or Merge() it concurrently and see a slightly stale
+// but consistent-per-bucket picture.
+class LatencyHistogram {
+ public:
+  static const unsigned kSubBits = 5;
+  static const unsigned kSub = 1u << kSubBits;
+  static const unsigned kMaxExp = 47;  // larger values are clamped
+  static const unsigned kBuckets = (kMaxExp - kSubBits + 2) * kSub;
+
+  LatencyHistogram() : counts_(kBuckets) {}
+
+  void Record(uint64_t v) {
+    Bump(counts_[Index(v)]);
+    Bump(count_);
+    sum_.store(sum_.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+    if (v > max_.load(std::memory_order_relaxed)) {
+      max_.store(v, std::memory_order_relaxed);
+    }
+  }
+
+  void Merge(const LatencyHistogram& other) {
+    for (unsigned i = 0; i < kBuckets; i++) {
+      counts_[i].fetch_add(other.counts_[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    count_.fetch_add(other.count_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    sum_.fetch_add(other.sum_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    uint64_t m = other.max_.load(std::memory_order_relaxed);
+    if (m > max_.load(std::memory_order_relaxed)) {
+      max_.store(m, std::memory_order_relaxed);
+    }
+  }
+
+  uint64_t Count() const {
+    return count_.load(std::memory_order_relaxed);
+  }
+
+  uint64_t Max() const {
+    return max_.load(std::memory_order_relaxed);
+  }
+
+  double Mean() const {
+    uint64_t n = Count();
+    return n ? double(sum_.load(std::memory_order_relaxed)) / n : 0.0;
+  }
+
+  // smallest bucket value v such that a fraction q of the records is <= v
+  uint64_t Percentile(double q) const {
+    uint64_t n = Count();
+    if (n == 0) {
+      return 0;
+    }
+    uint64_t rank = std::max<uint64_t>(1, uint64_t(q * n + 0.5));
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < kBuckets; i++) {
+      seen += counts_[i].load(std::memory_order_relaxed);
+      if (seen >= rank) {
+        return std::min(BucketTop(i), Max());
+      }
+    }
+    return Max();
+  }
+
+  // {"count":..,"mean":..,"p50":..,"p90":..,"p99":..,"p999":..,"max":..}, values multiplied
+  // by scale (e.g. ns per tick)
+  std::string ToJson(double scale = 1.0) const {
+    std::ostringstream os;
+    os << "{\"count\":" << Count() << ",\"mean\":" << Mean() * scale
+       << ",\"p50\":" << Percentile(0.5) * scale << ",\"p90\":" << Percentile(0.9) * scale
+       << ",\"p99\":" << Percentile(0.99) * scale << ",\"p999\":" << Percentile(0.999) * scale
+       << ",\"max\":" << Max() * scale << "}";
+    return os.str();
+  }
+
+ private:
+  static void Bump(std::atomic<uint64_t>& c) {
+    c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  static unsigned Index(uint64_t v) {
+    if (v < kSub) {
+      return unsigned(v);
+    }
+    unsigned e = 63 - __builtin_clzll(v);
+    if (e > kMaxExp) {
+      return kBuckets - 1;
+    }
+    return (e - kSubBits + 1) * kSub + unsigned((v >> (e - kSubBits)) & (kSub - 1));
+  }
+
+  // largest value that lands in bucket i
+  static uint64_t BucketTop(unsigned i) {
+    if (i < kSub) {
+      return i;
+    }
+    unsigned e = i / kSub + kSubBits - 1;
+    uint64_t sub = i % kSub;
+    return ((kSub + sub + 1) << (e - kSubBits)) - 1;
+  }
+
+  std::vector<std::atomic<uint64_t>> counts_;
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> sum_{0};
+  std::atomic<uint64_t> max_{0};
+};
+
+// Hand-off latency (ticks) and sampled queue depth for one queue, recorded into per-thread
+// histograms that are merged only when a report is asked for.
+class QueueStats {
+ public:
+  static const unsigned kDepthSampleEvery = 64;
+
+  struct Recorder {
+    LatencyHistogram handoff;
+    LatencyHistogram depth;
+    unsigned pops = 0;
+  };
+
+  QueueStats() : id_(NextId()) {}
+
+  // the calling thread's recorder, created on first use
+  Recorder& Local() {
+    // ids, unlike addresses, are never reused by a later QueueStats; entries of destroyed
+    // stats are dropped whenever the thread meets a new one, so a long-lived thread keeps
+    // only as many as there are live stats it has recorded into
+    thread_local std::vector<LocalEntry> mine;
+    thread_local LocalEntry last{0, {}, nullptr};
+    if (last.id == id_) {
+      return *last.recorder;
+    }
+    for (auto& e: mine) {
+      if (e.id == id_) {
+        last = e;
+        return *e.recorder;
+      }
+    }
+
+    auto dead = [](const LocalEntry& e) { return e.alive.expired(); };
+    mine.erase(std::remove_if(mine.begin(), mine.end(), dead), mine.end());
+    std::lock_guard<std::mutex> g(mutex_);
+    recorders_.push_back(std::make_unique<Recorder>());
+    mine.push_back({id_, alive_, recorders_.back().get()});
+    last = mine.back();
+    return *recorders_.back();
+  }
+
+  // depth() is called only for sampled pops: reading the queue size touches both of its
+  // index cache lines
+  template<class TDepth>
+  void RecordPop(uint64_t enqueue_ticks, TDepth&& depth) {
+    Recorder& r = Local();
+    r.handoff.Record(TickClock::Now() - enqueue_ticks);
+    if (r.pops++ % kDepthSampleEvery == 0) {
+      r.depth.Record(depth());
+    }
+  }
+
+  // merged over all threads: hand-off latency in nanoseconds and queue depth in items
+  std::string ToJson() const {
+    LatencyHistogram handoff, depth;
+    {
+      std::lock_guard<std::mutex> g(mutex_);
+      for (auto& r: recorders_) {
+        handoff.Merge(r->handoff);
+        depth.Merge(r->depth);
+      }
+    }
+    return "{\"handoff_ns\":" + handoff.ToJson(TickClock::NsPerTick()) + ",\"depth\":" + depth.ToJson() + "}";
+  }
+
+ private:
+  struct LocalEntry {
+    uint64_t id;
+    std::weak_ptr<const bool> alive;  // expires with the stats
+    Recorder* recorder;
+  };
+
+  static uint64_t NextId() {
+    static std::atomic<uint64_t> next{1};
+    return next++;
+  }
+
+  const uint64_t id_;
+  const std::shared_ptr<const bool> alive_ = std::make_shared<const bool>(true);
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<Recorder>> recorders_;
+};
+
+#ifdef QUEUE_LATENCY_STATS
+
+// Channel that stamps every item on Push() and records the hand-off latency and (sampled)
+// queue depth on Pop().
+template<typename T>
+class InstrumentedChannel {
+ public:
+  explicit InstrumentedChannel(size_t capacity) : channel_(capacity) {}
+
+  bool Push(const T& item) {
+    return channel_.Push({item, TickClock::Now()});
+  }
+
+  bool Pop(T& item) {
+    Stamped s;
+    if (!channel_.Pop(s)) {
+      return false;
+    }
+    stats_.RecordPop(s.ticks, [this]() { return channel_.Size(); });
+    item = std::move(s.value);
+    return true;
+  }
+
+  void Close() {
+    channel_.Close();
+  }
+
+  size_t Size() const {
+    return channel_.Size();
+  }
+
+  std::string StatsJson() const {
+    return stats_.ToJson();
+  }
+
+ private:
+  struct Stamped {
+    T value;
+    uint64_t ticks;
+  };
+
+  Channel<Stamped> channel_;
+  QueueStats stats_;
+};
+
+#else
+
+template<typename T>
+class InstrumentedChannel : public Channel<T> {
+ public:
+  using Channel<T>::Channel;
+
+  std::string StatsJson() const {
+    return "{}";
+  }
+};
+
+#endif
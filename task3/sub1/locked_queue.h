@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <queue>
+#include <span>
+
+// std::queue behind a mutex with the same TryPush/TryPop interface as the lock-free queues;
+// the baseline the benchmarks compare against.
+template<typename T>
+class LockedQueue {
+ public:
+  explicit LockedQueue(size_t capacity) : capacity_(capacity) {}
+
+  bool TryPush(const T& item) {
+    std::lock_guard<std::mutex> g(mutex_);
+    if (items_.size() >= capacity_) {
+      return false;
+    }
+    items_.push(item);
+    return true;
+  }
+
+  bool TryPop(T& item) {
+    std::lock_guard<std::mutex> g(mutex_);
+    if (items_.empty()) {
+      return false;
+    }
+    item = std::move(items_.front());
+    items_.pop();
+    return true;
+  }
+
+  size_t TryPushBulk(std::span<const T> items) {
+    std::lock_guard<std::mutex> g(mutex_);
+    size_t n = 0;
+    while (n < items.size() && items_.size() < capacity_) {
+      items_.push(items[n++]);
+    }
+    return n;
+  }
+
+  size_t TryPopBulk(T* out, size_t max) {
+    std::lock_guard<std::mutex> g(mutex_);
+    size_t n = 0;
+    while (n < max && !items_.empty()) {
+      out[n++] = std::move(items_.front());
+      items_.pop();
+    }
+    return n;
+  }
+
+  size_t Size() const {
+    std::lock_guard<std::mutex> g(mutex_);
+    return items_.size();
+  }
+
+  size_t Capacity() const {
+    return capacity_;
+  }
+
+ private:
+  const size_t capacity_;
+  mutable std::mutex mutex_;
+  std::queue<T> items_;
+};
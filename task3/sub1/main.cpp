@@ -0,0 +1,300 @@
+#include <iostream>
+#include <thread>
+#include <queue>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "affinity.h"
+#include "batch.h"
+#include "channel.h"
+#include "coro_channel.h"
+#include "shm_queue.h"
+#include "spsc_queue.h"
+
+using namespace std::chrono_literals;
+
+static const int kNumItems = 100000;
+
+// CPUs for the producer and consumer threads, -1: floating; the rings are first-touched by
+// the consumer's CPU
+static int producer_cpu = -1;
+static int consumer_cpu = -1;
+
+// std::queue guarded by a mutex, producer notifies once per item
+size_t RunLocked(int num_items) {
+  size_t count = 0;
+  std::atomic_bool done(false);
+
+  std::queue<int> items;
+  std::mutex items_mutex;
+  std::condition_variable push_cv, pop_cv;
+
+  std::thread producer([&]() {
+    PinCurrentThread(producer_cpu);
+    for (int i = 0; i < num_items; i++) {
+      {
+        std::lock_guard<std::mutex> g(items_mutex);
+        items.push(i);
+        count++;
+      }
+      push_cv.notify_all();
+    }
+
+    bool all_recvd = false;
+    while (!all_recvd) {
+      std::unique_lock<std::mutex> ul(items_mutex);
+      pop_cv.wait_for(ul, 1ms);
+
+      if (count == 0) {
+        done = true;
+        all_recvd = true;
+      }
+    }
+  });
+
+  std::thread consumer([&]() {
+    PinCurrentThread(consumer_cpu);
+    while (!done) {
+      std::unique_lock<std::mutex> ul(items_mutex);
+
+      push_cv.wait_for(ul, 1ms);
+
+      while (!items.empty()) {
+        items.pop();
+        // ...
+        count--;
+      }
+
+      pop_cv.notify_one();
+    }
+  });
+
+  producer.join();
+  consumer.join();
+
+  return count;
+}
+
+// lock-free SPSC ring, both sides yield while the ring is full/empty
+size_t RunSpsc(int num_items) {
+  auto ring = ConstructOnCpu<SpscQueue<int>>(consumer_cpu, 1024);
+  SpscQueue<int>& items = *ring;
+  size_t pushed = 0, popped = 0;
+
+  std::thread producer([&]() {
+    PinCurrentThread(producer_cpu);
+    for (int i = 0; i < num_items; i++) {
+      while (!items.TryPush(i)) {
+        std::this_thread::yield();
+      }
+      pushed++;
+    }
+  });
+
+  std::thread consumer([&]() {
+    PinCurrentThread(consumer_cpu);
+    int item;
+    while (popped < size_t(num_items)) {
+      while (!items.TryPop(item)) {
+        std::this_thread::yield();
+      }
+      // ...
+      popped++;
+    }
+  });
+
+  producer.join();
+  consumer.join();
+
+  return pushed - popped;
+}
+
+// SPSC ring behind adaptive spin/yield/park waits; Close() ends the consumer as soon as the
+// ring is drained, with no polling
+size_t RunChannel(int num_items) {
+  auto channel = ConstructOnCpu<Channel<int>>(consumer_cpu, 1024);
+  Channel<int>& items = *channel;
+  size_t pushed = 0, popped = 0;
+
+  std::thread producer([&]() {
+    PinCurrentThread(producer_cpu);
+    for (int i = 0; i < num_items; i++) {
+      items.Push(i);
+      pushed++;
+    }
+    items.Close();
+  });
+
+  std::thread consumer([&]() {
+    PinCurrentThread(consumer_cpu);
+    int item;
+    while (items.Pop(item)) {
+      // ...
+      popped++;
+    }
+  });
+
+  producer.join();
+  consumer.join();
+
+  return pushed - popped;
+}
+
+// the channel with auto-tuned producer batches and bulk pops: one publish and at most one
+// wake-up per batch instead of per item
+size_t RunChannelBulk(int num_items) {
+  auto channel = ConstructOnCpu<Channel<int>>(consumer_cpu, 1024);
+  Channel<int>& items = *channel;
+  size_t pushed = 0, popped = 0;
+
+  std::thread producer([&]() {
+    PinCurrentThread(producer_cpu);
+    BatchingProducer<int, Channel<int>> batcher(items);
+    for (int i = 0; i < num_items; i++) {
+      batcher.Push(i);
+      pushed++;
+    }
+    batcher.Flush();
+    items.Close();
+  });
+
+  std::thread consumer([&]() {
+    PinCurrentThread(consumer_cpu);
+    int buf[256];
+    while (size_t n = items.PopBulk(buf, 256)) {
+      // ...
+      popped += n;
+    }
+  });
+
+  producer.join();
+  consumer.join();
+
+  return pushed - popped;
+}
+
+// a producer and a consumer coroutine on two scheduler threads; a blocked side suspends
+// instead of holding its thread
+size_t RunCoroutine(int num_items) {
+  CoScheduler scheduler(2);
+  AsyncChannel<int> items(scheduler, 1024);
+  std::atomic<size_t> pushed(0), popped(0);
+
+  auto producer = [&]() -> CoTask {
+    for (int i = 0; i < num_items; i++) {
+      co_await items.Send(i);
+      pushed++;
+    }
+    items.Close();
+  };
+
+  auto consumer = [&]() -> CoTask {
+    while (co_await items.Recv()) {
+      // ...
+      popped++;
+    }
+  };
+
+  scheduler.Spawn(producer());
+  scheduler.Spawn(consumer());
+  scheduler.Join();
+
+  return pushed - popped;
+}
+
+// the same hand-off between two processes: the consumer is forked and attaches to the ring in
+// a shared memory segment
+size_t RunProcesses(int num_items) {
+  auto items = ShmQueue<int>::Create("/sub1_items", 1024, ShmQueue<int>::Role::Producer);
+  if (!items) {
+    return num_items;
+  }
+  // the consumer reports its count through an anonymous shared page
+  void* page = mmap(nullptr, sizeof(std::atomic<size_t>), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (page == MAP_FAILED) {
+    std::cerr << "mmap: " << std::strerror(errno) << std::endl;
+    ShmQueue<int>::Unlink("/sub1_items");
+    return num_items;
+  }
+  auto* popped = new (page) std::atomic<size_t>(0);
+
+  pid_t consumer = fork();
+  if (consumer < 0) {
+    std::cerr << "fork: " << std::strerror(errno) << std::endl;
+    munmap(page, sizeof(std::atomic<size_t>));
+    ShmQueue<int>::Unlink("/sub1_items");
+    return num_items;
+  }
+  if (consumer == 0) {
+    auto in = ShmQueue<int>::Open("/sub1_items", ShmQueue<int>::Role::Consumer);
+    if (!in) {
+      _exit(1);
+    }
+    int item;
+    while (in->Pop(item)) {
+      // ...
+      (*popped)++;
+    }
+    _exit(0);
+  }
+
+  // Push() fails if the consumer dies or never attaches; what it didn't get counts as left
+  for (int i = 0; i < num_items; i++) {
+    if (!items->Push(i)) {
+      break;
+    }
+  }
+  items->Close();
+  int status = 0;
+  waitpid(consumer, &status, 0);
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    std::cerr << "consumer process failed" << std::endl;
+  }
+  ShmQueue<int>::Unlink("/sub1_items");
+
+  size_t left = num_items - popped->load();
+  munmap(page, sizeof(std::atomic<size_t>));
+  return left;
+}
+
+template<class TRun>
+void Measure(const std::string& name, int num_items, TRun&& run) {
+  auto t0 = std::chrono::steady_clock::now();
+  size_t left = run(num_items);
+  auto t1 = std::chrono::steady_clock::now();
+
+  double sec = std::chrono::duration<double>(t1 - t0).count();
+  std::cout << name << ": " << num_items << " items in " << sec * 1e3 << " ms, "
+            << num_items / sec << " items/s, " << left << " left" << std::endl;
+}
+
+int main(int argc, char** argv) {
+  if (argc != 1 && argc != 2 && argc != 4) {
+    std::cerr << "usage: main [num_items [producer_cpu consumer_cpu]]" << std::endl;
+    return 1;
+  }
+  int num_items = argc > 1 ? std::atoi(argv[1]) : kNumItems;
+  if (argc == 4) {
+    producer_cpu = std::atoi(argv[2]);
+    consumer_cpu = std::atoi(argv[3]);
+  }
+
+  Measure("mutex + condvar", num_items, RunLocked);
+  Measure("spsc ring      ", num_items, RunSpsc);
+  Measure("spsc channel   ", num_items, RunChannel);
+  Measure("bulk channel   ", num_items, RunChannelBulk);
+  Measure("coroutine chan ", num_items, RunCoroutine);
+  Measure("shm (2 procs)  ", num_items, RunProcesses);
+
+  return 0;
+}
@@ -0,0 +1,387 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "channel.h"
+#include "mpmc_queue.h"
+
+// Multi-stage pipeline: a source, any number of map stages and a sink, each stage running on
+// its own threads and connected by bounded MPMC channels, so a slow stage pushes back on
+// everything upstream of it:
+//
+//   std::vector<StageStats> stats = PipelineBuilder(1024)
+//     .Source<std::string>("produce", [](Emitter<std::string>& emit) { ... emit(line); ... })
+//     .Map("parse", [](std::string s) { return Parse(s); }, {.parallelism = 4})
+//     .Map("enrich", [](Record r) { return Enrich(r); })
+//     .Sink("consume", [&](Record r) { ... }, {.stateless = false})
+//     .Run();
+//
+// A map whose function returns std::optional drops the items it maps to std::nullopt.
+//
+// Adjacent stateless stages are fused: the second function is called right after the first on
+// the same thread instead of through a channel, and the fused stage ("parse+enrich") runs with
+// the larger of the two parallelisms. Mark a stage .stateless = false if it must keep its own
+// threads (it keeps per-thread state, or its cost must show up separately in the stats).
+//
+// Each worker of a stage calls its own copy of the stage function: state a function captures
+// by value is per worker, state it captures by reference is shared by all the workers of the
+// stage and must be synchronized by the function.
+//
+// Run() reports per stage the items in and out, throughput, and the time its workers spent
+// stalled waiting for input (upstream is the bottleneck) or for room in the output buffer
+// (downstream is the bottleneck). Stall clocks are read only when a queue operation would
+// block, so a stage that never waits pays nothing for them.
+
+struct StageOptions {
+  unsigned parallelism = 1;
+  bool stateless = true;
+  size_t capacity = 0;  // input buffer; 0: the pipeline default
+};
+
+struct StageStats {
+  std::string name;
+  unsigned workers = 0;
+  uint64_t items_in = 0;
+  uint64_t items_out = 0;
+  double seconds = 0;       // first worker start to last worker exit
+  double input_stall = 0;   // summed over workers, seconds
+  double output_stall = 0;  // summed over workers, seconds
+};
+
+inline std::string FormatStageStats(const std::vector<StageStats>& stats) {
+  std::ostringstream os;
+  os << std::left << std::setw(24) << "stage" << std::right << std::setw(4) << "thr"
+     << std::setw(12) << "in" << std::setw(12) << "out" << std::setw(14) << "items/s"
+     << std::setw(12) << "in stall" << std::setw(12) << "out stall" << "\n";
+  for (const StageStats& s: stats) {
+    uint64_t items = std::max(s.items_in, s.items_out);
+    os << std::left << std::setw(24) << s.name << std::right << std::setw(4) << s.workers
+       << std::setw(12) << s.items_in << std::setw(12) << s.items_out
+       << std::setw(14) << (s.seconds > 0 ? uint64_t(items / s.seconds) : 0)
+       << std::setw(11) << std::fixed << std::setprecision(1) << s.input_stall * 1e3 << "ms"
+       << std::setw(10) << s.output_stall * 1e3 << "ms" << "\n";
+    os.unsetf(std::ios::fixed);
+  }
+  return os.str();
+}
+
+namespace pipeline {
+
+using Clock = std::chrono::steady_clock;
+
+// owned by one worker, merged into the stage stats when it exits
+struct WorkerCounters {
+  unsigned worker = 0;
+  uint64_t in = 0;
+  uint64_t out = 0;
+  Clock::duration input_stall{};
+  Clock::duration output_stall{};
+};
+
+template<typename T>
+using Link = Channel<T, MpmcQueue<T>>;
+
+// where a worker sends its results: the next channel or the next fused function
+template<typename T>
+using Emit = std::function<bool(T&&, WorkerCounters&)>;
+
+// one worker of a stage that is still open for fusion
+template<typename T>
+using Body = std::function<void(WorkerCounters&, const Emit<T>&)>;
+
+template<typename T>
+bool Push(Link<T>& link, T&& item, WorkerCounters& c) {
+  if (link.TryPush(item)) {
+    return true;
+  }
+  auto t0 = Clock::now();
+  bool ok = link.Push(item);
+  c.output_stall += Clock::now() - t0;
+  return ok;
+}
+
+template<typename T>
+bool Pop(Link<T>& link, T& item, WorkerCounters& c) {
+  if (link.TryPop(item)) {
+    return true;
+  }
+  auto t0 = Clock::now();
+  bool ok = link.Pop(item);
+  c.input_stall += Clock::now() - t0;
+  return ok;
+}
+
+template<typename T>
+struct IsOptional : std::false_type {};
+
+template<typename T>
+struct IsOptional<std::optional<T>> : std::true_type {};
+
+template<typename T>
+struct Unwrap {
+  using Type = T;
+};
+
+template<typename T>
+struct Unwrap<std::optional<T>> {
+  using Type = T;
+};
+
+// a materialized stage
+struct Stage {
+  StageStats stats;
+  std::function<void(WorkerCounters&)> work;
+  std::function<void()> finish;  // after the last worker exits: close the output
+};
+
+struct Graph {
+  size_t capacity;
+  bool fuse;
+  std::vector<std::unique_ptr<Stage>> stages;
+};
+
+}  // namespace pipeline
+
+template<typename T>
+class Emitter {
+ public:
+  // false if the pipeline no longer accepts items
+  bool operator()(T item) {
+    return emit_(std::move(item), counters_);
+  }
+
+  // 0 .. parallelism - 1
+  unsigned Worker() const {
+    return counters_.worker;
+  }
+
+ private:
+  friend class PipelineBuilder;
+
+  Emitter(const pipeline::Emit<T>& emit, pipeline::WorkerCounters& counters)
+    : emit_(emit), counters_(counters) {}
+
+  const pipeline::Emit<T>& emit_;
+  pipeline::WorkerCounters& counters_;
+};
+
+class Pipeline {
+ public:
+  // starts every stage, waits until the source is exhausted and the sink has drained; a
+  // pipeline runs once
+  std::vector<StageStats> Run() {
+    std::vector<std::thread> threads;
+    std::mutex stats_mutex;
+    std::vector<unsigned> running;
+    std::vector<pipeline::Clock::time_point> first(graph_->stages.size()), last(graph_->stages.size());
+
+    for (auto& s: graph_->stages) {
+      running.push_back(s->stats.workers);
+    }
+
+    for (size_t i = 0; i < graph_->stages.size(); i++) {
+      pipeline::Stage& stage = *graph_->stages[i];
+      first[i] = pipeline::Clock::time_point::max();
+      for (unsigned w = 0; w < stage.stats.workers; w++) {
+        // every worker runs its own copy of the stage function, made here before any of them
+        // starts, so what a stage captures by value is never shared between its workers
+        threads.emplace_back([&, i, w, work = stage.work]() mutable {
+          pipeline::WorkerCounters c;
+          c.worker = w;
+          auto start = pipeline::Clock::now();
+          work(c);
+          auto end = pipeline::Clock::now();
+
+          bool last_worker;
+          {
+            std::lock_guard<std::mutex> g(stats_mutex);
+            StageStats& s = stage.stats;
+            s.items_in += c.in;
+            s.items_out += c.out;
+            s.input_stall += std::chrono::duration<double>(c.input_stall).count();
+            s.output_stall += std::chrono::duration<double>(c.output_stall).count();
+            first[i] = std::min(first[i], start);
+            last[i] = std::max(last[i], end);
+            last_worker = --running[i] == 0;
+          }
+          if (last_worker) {
+            stage.finish();
+          }
+        });
+      }
+    }
+    for (auto& t: threads) {
+      t.join();
+    }
+
+    std::vector<StageStats> stats;
+    for (size_t i = 0; i < graph_->stages.size(); i++) {
+      StageStats s = graph_->stages[i]->stats;
+      s.seconds = std::chrono::duration<double>(last[i] - first[i]).count();
+      stats.push_back(s);
+    }
+    return stats;
+  }
+
+  size_t Stages() const {
+    return graph_->stages.size();
+  }
+
+ private:
+  template<typename> friend class PipelineStage;
+
+  explicit Pipeline(std::shared_ptr<pipeline::Graph> graph) : graph_(std::move(graph)) {}
+
+  std::shared_ptr<pipeline::Graph> graph_;
+};
+
+// A pipeline whose last stage produces T and is still open: the next stage is either fused
+// into it or connected to it through a new channel.
+template<typename T>
+class PipelineStage {
+ public:
+  template<class F>
+  auto Map(const std::string& name, F f, StageOptions options = {}) {
+    using R = std::invoke_result_t<F&, T&&>;
+    using U = typename pipeline::Unwrap<R>::Type;
+
+    auto step = [f](T&& item, const pipeline::Emit<U>& emit, pipeline::WorkerCounters& c) mutable {
+      if constexpr (pipeline::IsOptional<R>::value) {
+        std::optional<U> out = f(std::move(item));
+        return out ? emit(std::move(*out), c) : true;
+      } else {
+        return emit(f(std::move(item)), c);
+      }
+    };
+
+    if (CanFuse(options)) {
+      pipeline::Body<T> body = std::move(body_);
+      return PipelineStage<U>(graph_, name_ + "+" + name, std::max(parallelism_, options.parallelism), true,
+        [body, step](pipeline::WorkerCounters& c, const pipeline::Emit<U>& emit) mutable {
+          body(c, [&step, &emit](T&& item, pipeline::WorkerCounters& c) {
+            return step(std::move(item), emit, c);
+          });
+        });
+    }
+
+    auto link = Close(options);
+    return PipelineStage<U>(graph_, name, options.parallelism, options.stateless,
+      [link, step](pipeline::WorkerCounters& c, const pipeline::Emit<U>& emit) mutable {
+        T item;
+        while (pipeline::Pop(*link, item, c)) {
+          c.in++;
+          step(std::move(item), emit, c);
+        }
+      });
+  }
+
+  template<class F>
+  Pipeline Sink(const std::string& name, F f, StageOptions options = {}) {
+    if (CanFuse(options)) {
+      pipeline::Body<T> body = std::move(body_);
+      AddStage(name_ + "+" + name, std::max(parallelism_, options.parallelism),
+        [body, f](pipeline::WorkerCounters& c) mutable {
+          body(c, [&f](T&& item, pipeline::WorkerCounters&) {
+            f(std::move(item));
+            return true;
+          });
+        },
+        []() {});
+      return Pipeline(graph_);
+    }
+
+    auto link = Close(options);
+    AddStage(name, options.parallelism,
+      [link, f](pipeline::WorkerCounters& c) mutable {
+        T item;
+        while (pipeline::Pop(*link, item, c)) {
+          c.in++;
+          f(std::move(item));
+        }
+      },
+      []() {});
+    return Pipeline(graph_);
+  }
+
+ private:
+  friend class PipelineBuilder;
+  template<typename> friend class PipelineStage;
+
+  PipelineStage(std::shared_ptr<pipeline::Graph> graph, std::string name, unsigned parallelism,
+                bool stateless, pipeline::Body<T> body)
+    : graph_(std::move(graph))
+    , name_(std::move(name))
+    , parallelism_(std::max(1u, parallelism))
+    , stateless_(stateless)
+    , body_(std::move(body)) {}
+
+  bool CanFuse(const StageOptions& next) const {
+    return graph_->fuse && stateless_ && next.stateless;
+  }
+
+  // materializes the open stage with a channel as its output and returns that channel
+  std::shared_ptr<pipeline::Link<T>> Close(const StageOptions& next) {
+    auto link = std::make_shared<pipeline::Link<T>>(next.capacity ? next.capacity : graph_->capacity);
+    pipeline::Emit<T> emit = [link](T&& item, pipeline::WorkerCounters& c) {
+      c.out++;
+      return pipeline::Push(*link, std::move(item), c);
+    };
+    AddStage(name_, parallelism_,
+      [body = std::move(body_), emit](pipeline::WorkerCounters& c) { body(c, emit); },
+      [link]() { link->Close(); });
+    return link;
+  }
+
+  void AddStage(const std::string& name, unsigned parallelism,
+                std::function<void(pipeline::WorkerCounters&)> work, std::function<void()> finish) {
+    auto stage = std::make_unique<pipeline::Stage>();
+    stage->stats.name = name;
+    stage->stats.workers = std::max(1u, parallelism);
+    stage->work = std::move(work);
+    stage->finish = std::move(finish);
+    graph_->stages.push_back(std::move(stage));
+  }
+
+  std::shared_ptr<pipeline::Graph> graph_;
+  std::string name_;
+  unsigned parallelism_;
+  bool stateless_;
+  pipeline::Body<T> body_;
+};
+
+class PipelineBuilder {
+ public:
+  // capacity: default inter-stage buffer size; fuse: merge adjacent stateless stages
+  explicit PipelineBuilder(size_t capacity = 1024, bool fuse = true)
+    : graph_(std::make_shared<pipeline::Graph>()) {
+    graph_->capacity = capacity;
+    graph_->fuse = fuse;
+  }
+
+  // f(Emitter<T>&) runs once on each of the source's workers and emits items until it
+  // returns; the source is never fused
+  template<typename T, class F>
+  PipelineStage<T> Source(const std::string& name, F f, StageOptions options = {}) {
+    return PipelineStage<T>(graph_, name, options.parallelism, false,
+      [f](pipeline::WorkerCounters& c, const pipeline::Emit<T>& emit) mutable {
+        Emitter<T> emitter(emit, c);
+        f(emitter);
+      });
+  }
+
+ private:
+  std::shared_ptr<pipeline::Graph> graph_;
+};
@@ -0,0 +1,342 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "cache.h"
+#include "waiter.h"
+
+// SPSC ring in a POSIX shared memory segment, for a producer and a consumer in different
+// processes.
+//
+// The segment holds only indices and slots, never pointers, so each process may map it at a
+// different address. The ring is the same as SpscQueue: head and tail on their own cache
+// lines, each side caching the other's index in process-local memory.
+//
+// Blocking Push()/Pop() wait like AdaptiveWaiter: brief spinning, a few yields, then a
+// shared (not process-private) futex. The event count lives in the segment, so a process can
+// wake its peer. Parked waits time out every kPeerCheckMs to check that the peer process
+// still exists (kill(pid, 0), and it is not a zombie). If it is gone, Push() fails and Pop()
+// fails once the ring is drained, so the survivor never hangs. A crash can't leave the ring
+// inconsistent, because an item becomes visible only through the final index store. A new
+// process can Open() the segment in the dead peer's role and carry on. Pid reuse can mask a
+// crash until the reused pid exits too; that is the price of not needing a heartbeat thread.
+// A peer that never attaches at all counts as gone kAttachTimeoutMs after this side did, so
+// a consumer that failed to Open() can't leave the producer blocked forever either.
+//
+// T must be trivially copyable.
+
+namespace shm {
+
+inline long Futex(std::atomic<uint32_t>* addr, int op, uint32_t val, const timespec* timeout) {
+  static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex needs a plain word");
+  return syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), op, val, timeout, nullptr, 0);
+}
+
+// a zombie counts as dead: the peer may be our own unreaped child
+inline bool ProcessAlive(pid_t pid) {
+  if (kill(pid, 0) != 0 && errno != EPERM) {
+    return false;
+  }
+  std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+  std::string line;
+  if (!std::getline(stat, line)) {
+    return true;
+  }
+  size_t paren = line.rfind(')');
+  return paren == std::string::npos || paren + 2 >= line.size() || line[paren + 2] != 'Z';
+}
+
+// AdaptiveWaiter's event count, placed in shared memory
+struct alignas(kCacheLine) SharedWaiter {
+  std::atomic<uint32_t> epoch{0};
+  std::atomic<uint32_t> sleepers{0};
+
+  // true once ready(); false if give_up() says waiting is pointless
+  template<class TReady, class TGiveUp>
+  bool Wait(TReady&& ready, TGiveUp&& give_up, int check_ms) {
+    static const unsigned spins = std::thread::hardware_concurrency() > 1 ? AdaptiveWaiter::kSpins : 0;
+    for (unsigned i = 0; i < spins; i++) {
+      if (ready()) {
+        return true;
+      }
+      CpuRelax();
+    }
+    for (unsigned i = 0; i < AdaptiveWaiter::kYields; i++) {
+      if (ready()) {
+        return true;
+      }
+      std::this_thread::yield();
+    }
+
+    timespec timeout{check_ms / 1000, (check_ms % 1000) * 1000000L};
+    for (;;) {
+      uint32_t e = epoch.load(std::memory_order_acquire);
+      sleepers.fetch_add(1, std::memory_order_seq_cst);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (ready()) {
+        sleepers.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+      }
+      Futex(&epoch, FUTEX_WAIT, e, &timeout);
+      sleepers.fetch_sub(1, std::memory_order_relaxed);
+      if (ready()) {
+        return true;
+      }
+      if (give_up()) {
+        // one last look: the peer may have published right before it went away
+        return ready();
+      }
+    }
+  }
+
+  void NotifyAll() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers.load(std::memory_order_relaxed) > 0) {
+      epoch.fetch_add(1, std::memory_order_release);
+      Futex(&epoch, FUTEX_WAKE, INT_MAX, nullptr);
+    }
+  }
+};
+
+struct Header {
+  static const uint64_t kMagic = 0x45554555514d4853ULL;  // "SHMQUEUE" little-endian
+  static const uint32_t kVersion = 1;
+
+  std::atomic<uint64_t> magic{0};  // stored last by the creator
+  uint32_t version = kVersion;
+  uint32_t slot_size = 0;
+  uint64_t capacity = 0;
+  uint64_t slots_offset = 0;
+  std::atomic<int32_t> pids[2] = {};  // by ShmQueue::Role; 0 until attached
+  std::atomic<uint32_t> closed{0};
+
+  alignas(kCacheLine) std::atomic<uint64_t> head{0};
+  alignas(kCacheLine) std::atomic<uint64_t> tail{0};
+
+  SharedWaiter not_empty;
+  SharedWaiter not_full;
+};
+
+}  // namespace shm
+
+template<typename T>
+class ShmQueue {
+  static_assert(std::is_trivially_copyable_v<T>, "items are copied byte-wise between processes");
+
+ public:
+  enum class Role { Producer = 0, Consumer = 1 };
+
+  static const int kPeerCheckMs = 50;
+  static const int kAttachTimeoutMs = 5000;
+
+  // Creates (replacing any stale one) the segment /name and attaches to it in the given role;
+  // nullptr on failure. capacity is rounded up to a power of two.
+  static std::unique_ptr<ShmQueue> Create(const std::string& name, size_t capacity, Role role) {
+    size_t cap = 1;
+    while (cap < capacity) {
+      cap <<= 1;
+    }
+    size_t slots_offset = (sizeof(shm::Header) + kCacheLine - 1) / kCacheLine * kCacheLine;
+    size_t size = slots_offset + cap * sizeof(T);
+
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+      std::cerr << "shm_open " << name << ": " << std::strerror(errno) << std::endl;
+      return nullptr;
+    }
+    if (ftruncate(fd, size) != 0) {
+      std::cerr << "ftruncate " << name << ": " << std::strerror(errno) << std::endl;
+      close(fd);
+      shm_unlink(name.c_str());
+      return nullptr;
+    }
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+      std::cerr << "mmap " << name << ": " << std::strerror(errno) << std::endl;
+      shm_unlink(name.c_str());
+      return nullptr;
+    }
+
+    shm::Header* h = new (base) shm::Header;
+    h->slot_size = sizeof(T);
+    h->capacity = cap;
+    h->slots_offset = slots_offset;
+    h->magic.store(shm::Header::kMagic, std::memory_order_release);
+
+    return std::unique_ptr<ShmQueue>(new ShmQueue(base, size, role));
+  }
+
+  // attaches to a segment made by Create(); nullptr if it is missing or not a queue of T
+  static std::unique_ptr<ShmQueue> Open(const std::string& name, Role role) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+      std::cerr << "shm_open " << name << ": " << std::strerror(errno) << std::endl;
+      return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(shm::Header)) {
+      std::cerr << name << ": not a queue segment" << std::endl;
+      close(fd);
+      return nullptr;
+    }
+    size_t size = st.st_size;
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+      std::cerr << "mmap " << name << ": " << std::strerror(errno) << std::endl;
+      return nullptr;
+    }
+
+    auto* h = static_cast<shm::Header*>(base);
+    // the indices are masked with capacity - 1; the size check is written not to overflow
+    if (h->magic.load(std::memory_order_acquire) != shm::Header::kMagic ||
+        h->version != shm::Header::kVersion || h->slot_size != sizeof(T) ||
+        h->capacity == 0 || (h->capacity & (h->capacity - 1)) != 0 || h->slots_offset > size ||
+        h->capacity > (size - h->slots_offset) / sizeof(T)) {
+      std::cerr << name << ": not a queue of this item type" << std::endl;
+      munmap(base, size);
+      return nullptr;
+    }
+
+    return std::unique_ptr<ShmQueue>(new ShmQueue(base, size, role));
+  }
+
+  // removes the name; mappings stay valid until every process lets go of them
+  static void Unlink(const std::string& name) {
+    shm_unlink(name.c_str());
+  }
+
+  // the pid stays registered: a peer still waiting on us notices once this process exits,
+  // but a process that detaches and lives on should Close() first
+  ~ShmQueue() {
+    munmap(header_, size_);
+  }
+
+  ShmQueue(const ShmQueue&) = delete;
+  ShmQueue& operator=(const ShmQueue&) = delete;
+
+  bool TryPush(const T& item) {
+    uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+    if (tail - cached_head_ == capacity_) {
+      cached_head_ = header_->head.load(std::memory_order_acquire);
+      if (tail - cached_head_ == capacity_) {
+        return false;
+      }
+    }
+    std::memcpy(&slots_[tail & mask_], &item, sizeof(T));
+    header_->tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool TryPop(T& item) {
+    uint64_t head = header_->head.load(std::memory_order_relaxed);
+    if (head == cached_tail_) {
+      cached_tail_ = header_->tail.load(std::memory_order_acquire);
+      if (head == cached_tail_) {
+        return false;
+      }
+    }
+    std::memcpy(&item, &slots_[head & mask_], sizeof(T));
+    header_->head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // false if the queue is closed or the consumer is gone
+  bool Push(const T& item) {
+    bool pushed = false;
+    header_->not_full.Wait(
+      [&]() { return (pushed = TryPush(item)) || Closed(); },
+      [&]() { return PeerGone(); },
+      kPeerCheckMs);
+    if (pushed) {
+      header_->not_empty.NotifyAll();
+    }
+    return pushed;
+  }
+
+  // false once the queue is closed (or the producer is gone) and drained
+  bool Pop(T& item) {
+    bool popped = false;
+    header_->not_empty.Wait(
+      [&]() { return (popped = TryPop(item)) || Closed(); },
+      [&]() { return PeerGone(); },
+      kPeerCheckMs);
+    if (!popped) {
+      popped = TryPop(item);
+    }
+    if (popped) {
+      header_->not_full.NotifyAll();
+    }
+    return popped;
+  }
+
+  void Close() {
+    header_->closed.store(1, std::memory_order_release);
+    header_->not_empty.NotifyAll();
+    header_->not_full.NotifyAll();
+  }
+
+  bool Closed() const {
+    return header_->closed.load(std::memory_order_acquire) != 0;
+  }
+
+  // the peer attached and its process no longer exists, or it never attached in time
+  bool PeerGone() const {
+    pid_t peer = header_->pids[1 - int(role_)].load(std::memory_order_acquire);
+    if (peer == 0) {
+      return std::chrono::steady_clock::now() - attached_at_ > std::chrono::milliseconds(kAttachTimeoutMs);
+    }
+    return !shm::ProcessAlive(peer);
+  }
+
+  size_t Capacity() const {
+    return capacity_;
+  }
+
+ private:
+  ShmQueue(void* base, size_t size, Role role)
+    : header_(static_cast<shm::Header*>(base))
+    , size_(size)
+    , role_(role)
+    , slots_(reinterpret_cast<T*>(static_cast<char*>(base) + header_->slots_offset))
+    , capacity_(header_->capacity)
+    , mask_(capacity_ - 1)
+    , cached_head_(header_->head.load(std::memory_order_acquire))
+    , cached_tail_(header_->tail.load(std::memory_order_acquire))
+    , attached_at_(std::chrono::steady_clock::now()) {
+    header_->pids[int(role_)].store(getpid(), std::memory_order_release);
+  }
+
+  shm::Header* header_;
+  size_t size_;
+  Role role_;
+  T* slots_;
+  uint64_t capacity_;
+  uint64_t mask_;
+  uint64_t cached_head_;  // producer side
+  uint64_t cached_tail_;  // consumer side
+  std::chrono::steady_clock::time_point attached_at_;
+};
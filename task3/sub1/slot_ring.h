@@ -0,0 +1,198 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "affinity.h"
+#include "cache.h"
+#include "waiter.h"
+
+// Zero-copy single-producer/single-consumer ring of fixed-size byte slots, for messages too
+// big to copy through a queue by value.
+//
+// The producer reserves the next free slot, builds the message directly in it and commits it
+// with its length; the consumer acquires the oldest committed slot, reads the message where
+// it lies and releases the slot back to the producer. All slot memory is allocated up front
+// (cache-line aligned, each slot starting on its own line), so the steady state allocates
+// nothing and copies nothing:
+//
+//   std::span<std::byte> buf = ring.Reserve();
+//   size_t n = Serialize(record, buf);
+//   ring.Commit(n);
+//
+//   std::span<const std::byte> msg;
+//   while (ring.Acquire(msg)) {
+//     Handle(msg);
+//     ring.Release();
+//   }
+//
+// The indices work like SpscQueue's (cached opposite index, one release store per commit or
+// release). Blocking Reserve()/Acquire() wait through AdaptiveWaiters; Close() ends the
+// consumer once the ring is drained. One slot at a time is outstanding on each side.
+class SlotRing {
+ public:
+  // slots is rounded up to a power of two, slot_size up to a whole number of cache lines;
+  // node >= 0 binds the slot memory to that NUMA node (put it on the consumer's)
+  SlotRing(size_t slots, size_t slot_size, int node = -1)
+    : slots_(RoundUpPow2(slots))
+    , mask_(slots_ - 1)
+    , stride_((std::max<size_t>(slot_size, 1) + kCacheLine - 1) / kCacheLine * kCacheLine)
+    , slot_size_(slot_size)
+    , lengths_(slots_)
+    , data_(static_cast<std::byte*>(std::aligned_alloc(kCacheLine, slots_ * stride_))) {
+    if (!data_) {
+      throw std::bad_alloc();
+    }
+    BindToNode(data_.get(), slots_ * stride_, node);
+  }
+
+  SlotRing(const SlotRing&) = delete;
+  SlotRing& operator=(const SlotRing&) = delete;
+
+  // bytes available to one message
+  size_t SlotSize() const {
+    return slot_size_;
+  }
+
+  size_t Slots() const {
+    return slots_;
+  }
+
+  // producer: the next free slot, or an empty span if the ring is full
+  std::span<std::byte> TryReserve() {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ == slots_) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ == slots_) {
+        return {};
+      }
+    }
+    return {Slot(tail), slot_size_};
+  }
+
+  // producer: waits for a free slot; empty span if the ring was closed
+  std::span<std::byte> Reserve() {
+    std::span<std::byte> slot;
+    not_full_.Wait([&]() {
+      return !(slot = TryReserve()).empty() || closed_.load(std::memory_order_acquire);
+    });
+    return closed_.load(std::memory_order_acquire) ? std::span<std::byte>() : slot;
+  }
+
+  // producer: publishes the reserved slot holding a message of size bytes; throws
+  // std::length_error, publishing nothing, if size exceeds SlotSize()
+  void Commit(size_t size) {
+    if (size > slot_size_) {
+      throw std::length_error("SlotRing::Commit: message larger than a slot");
+    }
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    lengths_[tail & mask_] = size;
+    tail_.store(tail + 1, std::memory_order_release);
+    not_empty_.NotifyOne();
+  }
+
+  // producer: constructs a T in the next slot and commits it; false if closed. Throws
+  // std::length_error, before reserving anything, if a T doesn't fit in a slot.
+  template<typename T, typename... Args>
+  bool Emplace(Args&&... args) {
+    static_assert(alignof(T) <= kCacheLine, "slots are only cache-line aligned");
+    if (sizeof(T) > slot_size_) {
+      throw std::length_error("SlotRing::Emplace: item larger than a slot");
+    }
+    std::span<std::byte> slot = Reserve();
+    if (slot.empty()) {
+      return false;
+    }
+    new (slot.data()) T(std::forward<Args>(args)...);
+    Commit(sizeof(T));
+    return true;
+  }
+
+  // consumer: the oldest committed message, false if there is none
+  bool TryAcquire(std::span<const std::byte>& msg) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head == cached_tail_) {
+        return false;
+      }
+    }
+    msg = {Slot(head), lengths_[head & mask_]};
+    return true;
+  }
+
+  // consumer: waits for a message; false once the ring is closed and drained
+  bool Acquire(std::span<const std::byte>& msg) {
+    bool got = false;
+    not_empty_.Wait([&]() {
+      return (got = TryAcquire(msg)) || closed_.load(std::memory_order_acquire);
+    });
+    return got || TryAcquire(msg);
+  }
+
+  // consumer: hands the acquired slot back to the producer
+  void Release() {
+    head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    not_full_.NotifyOne();
+  }
+
+  // Release() for a slot built by Emplace<T>(): runs the destructor first
+  template<typename T>
+  void Release(const T* item) {
+    item->~T();
+    Release();
+  }
+
+  void Close() {
+    closed_.store(true, std::memory_order_release);
+    not_empty_.NotifyAll();
+    not_full_.NotifyAll();
+  }
+
+ private:
+  struct Free {
+    void operator()(std::byte* p) const {
+      std::free(p);
+    }
+  };
+
+  static size_t RoundUpPow2(size_t n) {
+    size_t p = 1;
+    while (p < n) {
+      p <<= 1;
+    }
+    return p;
+  }
+
+  std::byte* Slot(size_t index) const {
+    return data_.get() + (index & mask_) * stride_;
+  }
+
+  const size_t slots_;
+  const size_t mask_;
+  const size_t stride_;
+  const size_t slot_size_;
+  std::vector<size_t> lengths_;  // written before the tail store that publishes the slot
+  std::unique_ptr<std::byte, Free> data_;
+
+  // consumer line
+  alignas(kCacheLine) std::atomic<size_t> head_{0};
+  size_t cached_tail_ = 0;
+
+  // producer line
+  alignas(kCacheLine) std::atomic<size_t> tail_{0};
+  size_t cached_head_ = 0;
+
+  std::atomic_bool closed_{false};
+  AdaptiveWaiter not_empty_;
+  AdaptiveWaiter not_full_;
+};
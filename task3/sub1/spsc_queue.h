@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "cache.h"
+
+// Bounded single-producer/single-consumer ring buffer.
+//
+// The producer only writes tail_ and the consumer only writes head_, each on its own cache
+// line. Both sides also keep a private copy of the other side's index and re-read the shared
+// one only when the copy says the ring is full (producer) or empty (consumer), so in steady
+// state an item costs one slot write/read and one release store, with no cache line bouncing
+// between the threads except the slot itself.
+//
+// Exactly one thread may push and exactly one (other) thread may pop.
+
+template<typename T>
+class SpscQueue {
+ public:
+  // capacity is rounded up to a power of two
+  explicit SpscQueue(size_t capacity)
+    : buf_(RoundUpPow2(capacity))
+    , mask_(buf_.size() - 1) {}
+
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator=(const SpscQueue&) = delete;
+
+  bool TryPush(const T& item) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ == buf_.size()) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ == buf_.size()) {
+        return false;
+      }
+    }
+
+    buf_[tail & mask_] = item;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool TryPop(T& item) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head == cached_tail_) {
+        return false;
+      }
+    }
+
+    item = std::move(buf_[head & mask_]);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Pushes as many items from the front of items as fit and publishes them with a single
+  // release store; returns how many were pushed.
+  size_t TryPushBulk(std::span<const T> items) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (buf_.size() - (tail - cached_head_) < items.size()) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+    }
+
+    size_t n = std::min(buf_.size() - (tail - cached_head_), items.size());
+    for (size_t i = 0; i < n; i++) {
+      buf_[(tail + i) & mask_] = items[i];
+    }
+    if (n > 0) {
+      tail_.store(tail + n, std::memory_order_release);
+    }
+    return n;
+  }
+
+  // Pops up to max items into out with a single release store; returns how many were popped.
+  size_t TryPopBulk(T* out, size_t max) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (cached_tail_ - head < max) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+    }
+
+    size_t n = std::min(cached_tail_ - head, max);
+    for (size_t i = 0; i < n; i++) {
+      out[i] = std::move(buf_[(head + i) & mask_]);
+    }
+    if (n > 0) {
+      head_.store(head + n, std::memory_order_release);
+    }
+    return n;
+  }
+
+  // approximate when called concurrently with push/pop
+  size_t Size() const {
+    return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+  }
+
+  bool Empty() const {
+    return Size() == 0;
+  }
+
+  size_t Capacity() const {
+    return buf_.size();
+  }
+
+ private:
+  static size_t RoundUpPow2(size_t n) {
+    size_t p = 1;
+    while (p < n) {
+      p <<= 1;
+    }
+    return p;
+  }
+
+  std::vector<T> buf_;
+  const size_t mask_;
+
+  // consumer line
+  alignas(kCacheLine) std::atomic<size_t> head_{0};
+  size_t cached_tail_ = 0;
+
+  // producer line
+  alignas(kCacheLine) std::atomic<size_t> tail_{0};
+  size_t cached_head_ = 0;
+};
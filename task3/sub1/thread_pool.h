@@ -0,0 +1,359 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "cache.h"
+#include "mpmc_queue.h"
+#include "waiter.h"
+
+using Task = std::function<void()>;
+
+// Chase-Lev work-stealing deque (with the C11 orderings of Le et al., 2013).
+//
+// The owning worker pushes and pops at the bottom like a stack, which keeps recently spawned
+// (cache-hot) tasks local; thieves take the oldest task from the top with one CAS. The
+// circular array grows on demand; retired arrays are kept until the deque is destroyed
+// because a thief may still be reading one.
+template<typename T>
+class ChaseLevDeque {
+ public:
+  explicit ChaseLevDeque(size_t capacity = 256) {
+    arrays_.push_back(std::make_unique<Array>(capacity));
+    array_.store(arrays_.back().get(), std::memory_order_relaxed);
+  }
+
+  ChaseLevDeque(const ChaseLevDeque&) = delete;
+  ChaseLevDeque& operator=(const ChaseLevDeque&) = delete;
+
+  // owner only
+  void Push(T* item) {
+    int64_t b = bottom_.load(std::memory_order_relaxed);
+    int64_t t = top_.load(std::memory_order_acquire);
+    Array* a = array_.load(std::memory_order_relaxed);
+
+    if (b - t > int64_t(a->size) - 1) {
+      a = Grow(a, t, b);
+    }
+    a->Put(b, item);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(b + 1, std::memory_order_relaxed);
+  }
+
+  // owner only; nullptr if empty
+  T* Pop() {
+    int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+    Array* a = array_.load(std::memory_order_relaxed);
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top_.load(std::memory_order_relaxed);
+
+    if (t > b) {
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+
+    T* item = a->Get(b);
+    if (t == b) {
+      // last item: race the thieves for it
+      if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        item = nullptr;
+      }
+      bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+    return item;
+  }
+
+  // any thread; nullptr if empty or another thief won the race
+  T* Steal() {
+    int64_t t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom_.load(std::memory_order_acquire);
+
+    if (t >= b) {
+      return nullptr;
+    }
+
+    Array* a = array_.load(std::memory_order_acquire);
+    T* item = a->Get(t);
+    if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return item;
+  }
+
+  bool Empty() const {
+    return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Array {
+    explicit Array(size_t n) : size(n), mask(n - 1), slots(new std::atomic<T*>[n]) {}
+
+    T* Get(int64_t i) const {
+      return slots[i & mask].load(std::memory_order_relaxed);
+    }
+
+    void Put(int64_t i, T* item) {
+      slots[i & mask].store(item, std::memory_order_relaxed);
+    }
+
+    const size_t size;
+    const size_t mask;
+    std::unique_ptr<std::atomic<T*>[]> slots;
+  };
+
+  Array* Grow(Array* old, int64_t t, int64_t b) {
+    arrays_.push_back(std::make_unique<Array>(old->size * 2));
+    Array* a = arrays_.back().get();
+    for (int64_t i = t; i < b; i++) {
+      a->Put(i, old->Get(i));
+    }
+    array_.store(a, std::memory_order_release);
+    return a;
+  }
+
+  alignas(kCacheLine) std::atomic<int64_t> top_{0};
+  alignas(kCacheLine) std::atomic<int64_t> bottom_{0};
+  std::atomic<Array*> array_;
+  std::vector<std::unique_ptr<Array>> arrays_;  // owner only
+};
+
+// Work-stealing executor.
+//
+// Every worker owns a Chase-Lev deque: tasks spawned by a worker go to its own deque, tasks
+// from other threads go to a shared bounded injection queue. A worker looks for work in its
+// deque, then the injection queue, then steals from the other workers starting at a random
+// victim. Workers that find nothing park in an AdaptiveWaiter until a task is spawned.
+//
+// Waiting for tasks (TaskGroup::Wait, ParallelFor) runs other tasks in the meantime, so
+// fork-join recursion never blocks a worker. The destructor runs all tasks still queued.
+class WorkStealingPool {
+ public:
+  // 0 threads: one per hardware thread
+  explicit WorkStealingPool(unsigned threads = 0)
+    : injection_(kInjectionCapacity) {
+    if (threads == 0) {
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned i = 0; i < threads; i++) {
+      workers_.push_back(std::make_unique<Worker>());
+    }
+    for (unsigned i = 0; i < threads; i++) {
+      workers_[i]->thread = std::thread([this, i]() { WorkerLoop(i); });
+    }
+  }
+
+  ~WorkStealingPool() {
+    stop_.store(true, std::memory_order_release);
+    idle_.NotifyAll();
+    for (auto& w: workers_) {
+      w->thread.join();
+    }
+  }
+
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+  unsigned Size() const {
+    return unsigned(workers_.size());
+  }
+
+  // fire and forget
+  void Spawn(Task task) {
+    Task* t = new Task(std::move(task));
+    pending_.fetch_add(1, std::memory_order_relaxed);
+
+    if (current_pool_ == this) {
+      workers_[current_index_]->deque.Push(t);
+    } else {
+      while (!injection_.TryPush(t)) {
+        // injection queue is full: help drain it
+        if (!TryRunOne()) {
+          std::this_thread::yield();
+        }
+      }
+    }
+    idle_.NotifyOne();
+  }
+
+  template<class F>
+  auto Submit(F&& f) -> std::future<std::invoke_result_t<F>> {
+    using R = std::invoke_result_t<F>;
+    auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+    std::future<R> result = task->get_future();
+    Spawn([task]() { (*task)(); });
+    return result;
+  }
+
+  // runs one queued task on the calling thread; false if none was found
+  bool TryRunOne() {
+    Task* t = FindTask(current_pool_ == this ? int(current_index_) : -1);
+    if (!t) {
+      return false;
+    }
+    Run(t);
+    return true;
+  }
+
+  // f(i) for every i in [begin, end), split recursively down to chunks of grain
+  template<class F>
+  void ParallelFor(size_t begin, size_t end, size_t grain, F&& f);
+
+ private:
+  static const size_t kInjectionCapacity = 1 << 16;
+  static const unsigned kSpinRounds = 64;
+
+  struct Worker {
+    ChaseLevDeque<Task> deque;
+    std::thread thread;
+    uint64_t rng = 0x9e3779b97f4a7c15ULL;
+  };
+
+  Task* FindTask(int self) {
+    if (self >= 0) {
+      if (Task* t = workers_[self]->deque.Pop()) {
+        return Taken(t);
+      }
+    }
+
+    Task* t = nullptr;
+    if (injection_.TryPop(t)) {
+      return Taken(t);
+    }
+
+    size_t n = workers_.size();
+    size_t start = self >= 0 ? size_t(NextRandom(*workers_[self]) % n) : 0;
+    for (size_t k = 0; k < n; k++) {
+      size_t victim = (start + k) % n;
+      if (int(victim) == self) {
+        continue;
+      }
+      if (Task* s = workers_[victim]->deque.Steal()) {
+        return Taken(s);
+      }
+    }
+    return nullptr;
+  }
+
+  Task* Taken(Task* t) {
+    pending_.fetch_sub(1, std::memory_order_relaxed);
+    return t;
+  }
+
+  static void Run(Task* t) {
+    (*t)();
+    delete t;
+  }
+
+  static uint64_t NextRandom(Worker& w) {
+    w.rng ^= w.rng << 13;
+    w.rng ^= w.rng >> 7;
+    w.rng ^= w.rng << 17;
+    return w.rng;
+  }
+
+  void WorkerLoop(unsigned index) {
+    current_pool_ = this;
+    current_index_ = index;
+    workers_[index]->rng += index;
+
+    for (;;) {
+      Task* t = nullptr;
+      for (unsigned i = 0; i < kSpinRounds && !t; i++) {
+        t = FindTask(int(index));
+        if (!t) {
+          CpuRelax();
+        }
+      }
+
+      if (t) {
+        Run(t);
+        continue;
+      }
+
+      if (stop_.load(std::memory_order_acquire) && pending_.load(std::memory_order_acquire) == 0) {
+        break;
+      }
+
+      idle_.Wait([this]() {
+        return pending_.load(std::memory_order_acquire) > 0 || stop_.load(std::memory_order_acquire);
+      });
+    }
+
+    current_pool_ = nullptr;
+  }
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  MpmcQueue<Task*> injection_;
+  alignas(kCacheLine) std::atomic<size_t> pending_{0};  // spawned, not yet taken
+  std::atomic_bool stop_{false};
+  AdaptiveWaiter idle_;
+
+  static inline thread_local WorkStealingPool* current_pool_ = nullptr;
+  static inline thread_local unsigned current_index_ = 0;
+};
+
+// Fork-join scope: Spawn() any number of tasks, Wait() returns when all of them (and nothing
+// else) have finished, running queued tasks on the waiting thread meanwhile. Works with any
+// pool that has Spawn(Task) and TryRunOne().
+template<class TPool>
+class TaskGroup {
+ public:
+  explicit TaskGroup(TPool& pool) : pool_(pool) {}
+
+  ~TaskGroup() {
+    Wait();
+  }
+
+  template<class F>
+  void Spawn(F&& f) {
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    pool_.Spawn([this, f = std::forward<F>(f)]() mutable {
+      f();
+      pending_.fetch_sub(1, std::memory_order_release);
+    });
+  }
+
+  void Wait() {
+    while (pending_.load(std::memory_order_acquire) > 0) {
+      if (!pool_.TryRunOne()) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+ private:
+  TPool& pool_;
+  std::atomic<size_t> pending_{0};
+};
+
+template<class TPool, class F>
+void ParallelForSplit(TaskGroup<TPool>& group, size_t begin, size_t end, size_t grain, F& f) {
+  // hand the upper halves to thieves, keep the lowest chunk
+  while (end - begin > grain) {
+    size_t mid = begin + (end - begin) / 2;
+    group.Spawn([&group, mid, end, grain, &f]() { ParallelForSplit(group, mid, end, grain, f); });
+    end = mid;
+  }
+  for (size_t i = begin; i < end; i++) {
+    f(i);
+  }
+}
+
+template<class F>
+void WorkStealingPool::ParallelFor(size_t begin, size_t end, size_t grain, F&& f) {
+  if (begin >= end) {
+    return;
+  }
+  TaskGroup<WorkStealingPool> group(*this);
+  ParallelForSplit(group, begin, end, std::max<size_t>(grain, 1), f);
+  group.Wait();
+}
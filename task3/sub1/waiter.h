@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "cache.h"
+
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+// Adaptive wait for a condition published by another thread: spin with pause for a short
+// while (hand-offs between busy threads complete in well under a microsecond), then yield the
+// CPU a few times, then park in the kernel on a futex via std::atomic::wait.
+//
+// It is an event count: a parking waiter registers itself and snapshots epoch_ before its
+// final check of the condition, and Notify*() bumps epoch_ only when someone is registered.
+// So a notifier that finds no sleepers pays a fence and a load, and a wake-up can't be lost
+// between the waiter's last check and its sleep.
+//
+// The condition must be published before Notify*() is called.
+class AdaptiveWaiter {
+ public:
+  static const unsigned kSpins = 256;
+  static const unsigned kYields = 16;
+
+  template<class TPred>
+  void Wait(TPred&& ready) {
+    // on a single CPU the other side can't make progress while we spin
+    static const unsigned spins = std::thread::hardware_concurrency() > 1 ? kSpins : 0;
+
+    for (unsigned i = 0; i < spins; i++) {
+      if (ready()) {
+        return;
+      }
+      CpuRelax();
+    }
+
+    for (unsigned i = 0; i < kYields; i++) {
+      if (ready()) {
+        return;
+      }
+      std::this_thread::yield();
+    }
+
+    for (;;) {
+      uint32_t epoch = epoch_.load(std::memory_order_acquire);
+      sleepers_.fetch_add(1, std::memory_order_seq_cst);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+
+      if (ready()) {
+        sleepers_.fetch_sub(1, std::memory_order_relaxed);
+        return;
+      }
+
+      epoch_.wait(epoch, std::memory_order_acquire);
+      sleepers_.fetch_sub(1, std::memory_order_relaxed);
+
+      if (ready()) {
+        return;
+      }
+    }
+  }
+
+  void NotifyOne() {
+    if (HasSleepers()) {
+      epoch_.fetch_add(1, std::memory_order_release);
+      epoch_.notify_one();
+    }
+  }
+
+  void NotifyAll() {
+    if (HasSleepers()) {
+      epoch_.fetch_add(1, std::memory_order_release);
+      epoch_.notify_all();
+    }
+  }
+
+ private:
+  bool HasSleepers() const {
+    // pairs with the fence in Wait(): either the waiter sees the published condition or we
+    // see the waiter
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return sleepers_.load(std::memory_order_relaxed) != 0;
+  }
+
+  alignas(kCacheLine) std::atomic<uint32_t> epoch_{0};
+  std::atomic<uint32_t> sleepers_{0};
+};
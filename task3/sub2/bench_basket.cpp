@@ -0,0 +1,79 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "product.h"
+#include "shop.h"
+
+// Basket checkouts: random baskets from a shop with N products (10^6 by default, so the
+// catalog and the products are out of cache), sold with one SellBatch call against one Sell
+// call per item, by pointer and by ID.
+//
+//   ./bench_basket [num_products [basket_size [num_baskets]]]
+
+template<class F>
+double NsPerItem(size_t items, F&& f) {
+  auto t0 = std::chrono::steady_clock::now();
+  f();
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / items;
+}
+
+int main(int argc, char** argv) {
+  size_t n = argc > 1 ? std::atol(argv[1]) : 1000000;
+  size_t basket_size = argc > 2 ? std::atol(argv[2]) : 32;
+  size_t num_baskets = argc > 3 ? std::atol(argv[3]) : 100000;
+
+  ShopBasePtr shop(new ShopBase());
+  std::vector<ProductBasePtr> products;
+  {
+    ShopBase::Batch batch(*shop);
+    for (size_t i = 0; i < n; i++) {
+      products.push_back(std::make_shared<ProductBase>(1.0));
+      products.back()->StartSales();
+      shop->AddProduct(products.back());
+    }
+  }
+
+  std::mt19937_64 rng(42);
+  std::uniform_int_distribution<size_t> pick(0, n - 1);
+  std::vector<size_t> baskets(basket_size * num_baskets);
+  std::vector<ProductId> ids(baskets.size());
+  for (size_t i = 0; i < baskets.size(); i++) {
+    baskets[i] = pick(rng);
+    ids[i] = products[baskets[i]]->GetId();
+  }
+  std::vector<double> prices(basket_size);
+  double by_ptr_sum = 0, by_id_sum = 0, batch_sum = 0;
+
+  double by_ptr = NsPerItem(ids.size(), [&]() {
+    for (size_t i = 0; i < baskets.size(); i++) {
+      by_ptr_sum += shop->Sell(products[baskets[i]]);
+    }
+  });
+  double by_id = NsPerItem(ids.size(), [&]() {
+    for (size_t i = 0; i < ids.size(); i++) {
+      by_id_sum += shop->Sell(ids[i]);
+    }
+  });
+  double batch = NsPerItem(ids.size(), [&]() {
+    for (size_t b = 0; b < num_baskets; b++) {
+      shop->SellBatch(std::span<const ProductId>(&ids[b * basket_size], basket_size), prices);
+      for (double p: prices) {
+        batch_sum += p;
+      }
+    }
+  });
+
+  bool ok = by_ptr_sum == double(ids.size()) && by_id_sum == by_ptr_sum && batch_sum == by_ptr_sum;
+  std::cout << n << " products, " << num_baskets << " baskets of " << basket_size
+            << ", ns per item" << std::endl;
+  std::cout << std::fixed << std::setprecision(1);
+  std::cout << std::setw(22) << "Sell(weak_ptr) each" << std::setw(10) << by_ptr << std::endl;
+  std::cout << std::setw(22) << "Sell(id) each" << std::setw(10) << by_id << std::endl;
+  std::cout << std::setw(22) << "SellBatch" << std::setw(10) << batch
+            << (ok ? "" : "  WRONG RESULT") << std::endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "product.h"
+#include "shop.h"
+
+// One shop with N products (10^6 by default): add all, sell each once in random order by
+// pointer and by ID, remove all. The hash catalog against the original std::set of weak
+// pointers ordered by lock()ed address.
+//
+//   ./bench_catalog [num_products]
+
+// the catalog ShopBase used to have
+class SetShop : public IShop {
+ public:
+  ShopId GetId() const override {
+    return 0;  // never attached to a product
+  }
+
+  void AddProduct(IProductPtr prod) override {
+    std::lock_guard<std::mutex> g(mutex_);
+    products_.insert(prod);
+  }
+
+  void RemoveProduct(IProductPtr prod) override {
+    std::lock_guard<std::mutex> g(mutex_);
+    auto f = products_.find(prod);
+    if (f != products_.end()) {
+      products_.erase(f);
+    }
+  }
+
+  double Sell(IProductWeakPtr w_prod) override {
+    IProductPtr prod;
+    {
+      std::lock_guard<std::mutex> g(mutex_);
+      if (products_.find(w_prod) == products_.end()) {
+        return -1.0;
+      }
+      prod = w_prod.lock();
+    }
+    return prod ? prod->GetPrice() : -1.0;
+  }
+
+  double Sell(ProductId) override {
+    return -1.0;  // no index by ID
+  }
+
+ private:
+  struct WeakLess {
+    bool operator()(const IProductWeakPtr& p1, const IProductWeakPtr& p2) const {
+      auto lp1 = p1.lock(), lp2 = p2.lock();
+      if (!lp2) return false;
+      if (!lp1) return true;
+      return lp1 < lp2;
+    }
+  };
+
+  std::mutex mutex_;
+  std::set<IProductWeakPtr, WeakLess> products_;
+};
+
+template<class F>
+double NsPerOp(size_t n, F&& f) {
+  auto t0 = std::chrono::steady_clock::now();
+  f();
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / n;
+}
+
+struct Result {
+  double add, sell, sell_id, remove;
+  bool ok;
+};
+
+template<class TShop>
+Result Run(const std::vector<ProductBasePtr>& products, const std::vector<size_t>& order, bool by_id) {
+  auto shop = std::make_shared<TShop>();
+  Result r{};
+  double sum = 0;
+  size_t n = products.size();
+
+  r.add = NsPerOp(n, [&]() {
+    for (auto& p: products) {
+      shop->AddProduct(p);
+    }
+  });
+  r.sell = NsPerOp(n, [&]() {
+    for (size_t i: order) {
+      sum += shop->Sell(products[i]);
+    }
+  });
+  if (by_id) {
+    r.sell_id = NsPerOp(n, [&]() {
+      for (size_t i: order) {
+        sum += shop->Sell(products[i]->GetId());
+      }
+    });
+  }
+  r.remove = NsPerOp(n, [&]() {
+    for (size_t i: order) {
+      shop->RemoveProduct(products[i]);
+    }
+  });
+
+  r.ok = sum == double(n) * (by_id ? 2 : 1) && shop->Sell(products[0]) < 0;
+  return r;
+}
+
+int main(int argc, char** argv) {
+  size_t n = argc > 1 ? std::atol(argv[1]) : 1000000;
+
+  std::vector<ProductBasePtr> products;
+  for (size_t i = 0; i < n; i++) {
+    products.push_back(std::make_shared<ProductBase>(1.0));
+    products.back()->StartSales();
+  }
+  std::vector<size_t> order(n);
+  for (size_t i = 0; i < n; i++) {
+    order[i] = i;
+  }
+  std::shuffle(order.begin(), order.end(), std::mt19937_64(42));
+
+  Result hash = Run<ShopBase>(products, order, true);
+  Result set = Run<SetShop>(products, order, false);
+
+  std::cout << n << " products, ns per operation" << std::endl;
+  std::cout << std::setw(10) << "" << std::setw(10) << "add" << std::setw(10) << "sell"
+            << std::setw(10) << "sell id" << std::setw(10) << "remove" << std::endl;
+  std::cout << std::fixed << std::setprecision(1);
+  std::cout << std::setw(10) << "hash" << std::setw(10) << hash.add << std::setw(10) << hash.sell
+            << std::setw(10) << hash.sell_id << std::setw(10) << hash.remove
+            << (hash.ok ? "" : "  WRONG RESULT") << std::endl;
+  std::cout << std::setw(10) << "set" << std::setw(10) << set.add << std::setw(10) << set.sell
+            << std::setw(10) << "-" << std::setw(10) << set.remove
+            << (set.ok ? "" : "  WRONG RESULT") << std::endl;
+  return hash.ok && set.ok ? 0 : 1;
+}
@@ -0,0 +1,88 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "product.h"
+#include "shop.h"
+
+// Threads selling the same few hot products: by weak pointer, where every sale locks the
+// weak pointer and so bumps the product's shared reference count twice, against by ID,
+// where the registry handle is checked and the price read with plain loads.
+//
+//   ./bench_handles [--products N] [--sells K] [--max-threads T]
+
+template<class F>
+double SellsPerSec(unsigned threads, long sells, F&& sell) {
+  auto t0 = std::chrono::steady_clock::now();
+  std::vector<std::thread> sellers;
+  for (unsigned t = 0; t < threads; t++) {
+    sellers.emplace_back([&, t]() {
+      std::mt19937 rng(t);
+      double sum = 0;
+      for (long i = 0; i < sells; i++) {
+        sum += sell(rng());
+      }
+      volatile double sink = sum;
+      (void)sink;
+    });
+  }
+  for (auto& s: sellers) {
+    s.join();
+  }
+  return threads * sells / std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main(int argc, char** argv) {
+  size_t num_products = 8;
+  long sells = 2000000;
+  unsigned max_threads = 32;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--products" && i + 1 < argc) {
+      num_products = std::atol(argv[++i]);
+    } else if (arg == "--sells" && i + 1 < argc) {
+      sells = std::atol(argv[++i]);
+    } else if (arg == "--max-threads" && i + 1 < argc) {
+      max_threads = std::atoi(argv[++i]);
+    } else {
+      std::cerr << "usage: bench_handles [--products N] [--sells K] [--max-threads T]" << std::endl;
+      return 1;
+    }
+  }
+
+  ShopBasePtr shop(new ShopBase());
+  std::vector<ProductBasePtr> products;
+  std::vector<IProductWeakPtr> weak;
+  std::vector<ProductId> ids;
+  for (size_t i = 0; i < num_products; i++) {
+    products.push_back(std::make_shared<ProductBase>(1.0));
+    products.back()->StartSales();
+    products.back()->Attach(shop);
+    weak.push_back(products.back());
+    ids.push_back(products.back()->GetId());
+  }
+
+  std::cout << num_products << " hot products, " << sells << " sells per thread, hardware threads: "
+            << std::thread::hardware_concurrency() << std::endl;
+  std::cout << std::setw(8) << "threads" << std::setw(16) << "id sells/s" << std::setw(16)
+            << "weak sells/s" << std::setw(10) << "speedup" << std::endl;
+
+  for (unsigned t = 1; t <= max_threads; t *= 2) {
+    double by_id = SellsPerSec(t, sells, [&](uint32_t r) {
+      return shop->Sell(ids[r % num_products]);
+    });
+    double by_weak = SellsPerSec(t, sells, [&](uint32_t r) {
+      return shop->Sell(weak[r % num_products]);
+    });
+    std::cout << std::setw(8) << t << std::setw(16) << uint64_t(by_id) << std::setw(16)
+              << uint64_t(by_weak) << std::setw(10) << std::fixed << std::setprecision(2)
+              << by_id / by_weak << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <random>
+#include <vector>
+
+#include "product.h"
+#include "shop.h"
+
+// One product carried by N shops (10^4 by default): attach to all, StopSales/StartSales
+// rounds, detach from all in random order, with a fifth of the shops closing halfway. The
+// slot vector of ProductBase against the std::list it used to walk. The shops only count
+// calls, so the times are the product's own bookkeeping.
+//
+//   ./bench_membership [num_shops [rounds]]
+
+class CountingShop : public IShop {
+ public:
+  CountingShop() : id_(next_id_++) {}
+
+  ShopId GetId() const override {
+    return id_;
+  }
+
+  void AddProduct(IProductPtr) override {
+    calls_++;
+  }
+
+  void RemoveProduct(IProductPtr) override {
+    calls_++;
+  }
+
+  double Sell(IProductWeakPtr) override {
+    return -1.0;
+  }
+
+  double Sell(ProductId) override {
+    return -1.0;
+  }
+
+  static size_t Calls() {
+    return calls_;
+  }
+
+ private:
+  static inline ShopId next_id_ = 1;
+  static inline size_t calls_ = 0;
+  const ShopId id_;
+};
+
+// the shop list ProductBase used to have
+class ListProduct : public IProduct, public std::enable_shared_from_this<ListProduct> {
+ public:
+  explicit ListProduct(double price) : price_(price) {}
+
+  void Attach(IShopWeakPtr w_shop) override {
+    auto shop = w_shop.lock();
+    if (shop) {
+      shops_.push_back(shop);
+      shop->AddProduct(shared_from_this());
+    }
+  }
+
+  void Detach(IShopWeakPtr w_shop) override {
+    auto shop = w_shop.lock();
+    if (shop) {
+      shops_.remove_if([&w_shop](const IShopWeakPtr& w) {
+        auto lp1 = w.lock();
+        auto lp2 = w_shop.lock();
+        if (!lp1) return true;
+        if (!lp2) return false;
+        return lp1 == lp2;
+      });
+      shop->RemoveProduct(shared_from_this());
+    }
+  }
+
+  void StartSales() override {
+    started_ = true;
+    for (IShopWeakPtr& w_shop: shops_) {
+      auto shop = w_shop.lock();
+      if (shop) {
+        shop->AddProduct(shared_from_this());
+      }
+    }
+  }
+
+  void StopSales() override {
+    started_ = false;
+    for (IShopWeakPtr& w_shop: shops_) {
+      auto shop = w_shop.lock();
+      if (shop) {
+        shop->RemoveProduct(shared_from_this());
+      }
+    }
+  }
+
+  void ChangePrice(double price) override {
+    price_ = price;
+  }
+
+  double GetPrice() const override {
+    return started_ ? price_ : -1.0;
+  }
+
+  ProductId GetId() const override {
+    return ~ProductId(0);
+  }
+
+ private:
+  std::list<IShopWeakPtr> shops_;
+  double price_;
+  bool started_ = false;
+};
+
+template<class F>
+double UsPerOp(size_t n, F&& f) {
+  auto t0 = std::chrono::steady_clock::now();
+  f();
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / n;
+}
+
+struct Result {
+  double attach, round, detach;
+  size_t calls;
+};
+
+template<class TProduct>
+Result Run(size_t num_shops, size_t rounds) {
+  std::vector<std::shared_ptr<CountingShop>> shops;
+  for (size_t i = 0; i < num_shops; i++) {
+    shops.push_back(std::make_shared<CountingShop>());
+  }
+  auto prod = std::make_shared<TProduct>(1.0);
+  size_t calls0 = CountingShop::Calls();
+  Result r{};
+
+  r.attach = UsPerOp(num_shops, [&]() {
+    for (auto& s: shops) {
+      prod->Attach(s);
+    }
+  });
+  r.round = UsPerOp(rounds, [&]() {
+    for (size_t i = 0; i < rounds; i++) {
+      prod->StopSales();
+      prod->StartSales();
+    }
+  });
+
+  std::vector<std::shared_ptr<CountingShop>> order(shops);
+  std::shuffle(order.begin(), order.end(), std::mt19937_64(42));
+  shops.clear();
+  for (size_t i = 0; i < order.size(); i += 5) {
+    order[i].reset();
+  }
+  r.detach = UsPerOp(num_shops, [&]() {
+    for (auto& s: order) {
+      if (s) {
+        prod->Detach(s);
+      }
+    }
+  });
+
+  r.calls = CountingShop::Calls() - calls0;
+  return r;
+}
+
+int main(int argc, char** argv) {
+  size_t num_shops = argc > 1 ? std::atol(argv[1]) : 10000;
+  size_t rounds = argc > 2 ? std::atol(argv[2]) : 100;
+
+  Result slots = Run<ProductBase>(num_shops, rounds);
+  Result list = Run<ListProduct>(num_shops, rounds);
+
+  std::cout << "1 product, " << num_shops << " shops, " << rounds << " stop/start rounds" << std::endl;
+  std::cout << std::setw(8) << "" << std::setw(14) << "attach us" << std::setw(14) << "round us"
+            << std::setw(14) << "detach us" << std::endl;
+  std::cout << std::fixed << std::setprecision(3);
+  std::cout << std::setw(8) << "slots" << std::setw(14) << slots.attach << std::setw(14) << slots.round
+            << std::setw(14) << slots.detach << std::endl;
+  std::cout << std::setw(8) << "list" << std::setw(14) << list.attach << std::setw(14) << list.round
+            << std::setw(14) << list.detach << std::endl;
+
+  bool ok = slots.calls == list.calls;
+  if (!ok) {
+    std::cout << "WRONG RESULT: " << slots.calls << " vs " << list.calls << " shop calls" << std::endl;
+  }
+  return ok ? 0 : 1;
+}
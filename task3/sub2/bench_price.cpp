@@ -0,0 +1,134 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "product.h"
+
+// GetPrice() under a read-heavy mix: every thread works on a few hot products and turns one
+// operation in --write-permille into ChangePrice, StartSales or StopSales. The seqlock of
+// ProductBase against the mutex it used to take for every read.
+//
+//   ./bench_price [--products N] [--ops K] [--max-threads T] [--write-permille W]
+
+// the price state ProductBase used to have; no shops, so no shop notifications
+class MutexProduct {
+ public:
+  explicit MutexProduct(double price) : price_(price), started_(false) {}
+
+  void StartSales() {
+    started_ = true;
+  }
+
+  void StopSales() {
+    started_ = false;
+  }
+
+  void ChangePrice(double price) {
+    std::lock_guard<std::mutex> g(mutex_);
+    price_ = price;
+  }
+
+  double GetPrice() const {
+    if (!started_) {
+      return -1.0;
+    } else {
+      std::lock_guard<std::mutex> g(mutex_);
+      return price_;
+    }
+  }
+
+ private:
+  double price_;
+  mutable std::mutex mutex_;
+  std::atomic_bool started_;
+};
+
+template<class TProduct>
+double OpsPerSec(size_t num_products, unsigned threads, long ops, unsigned write_permille) {
+  std::vector<std::shared_ptr<TProduct>> products;
+  for (size_t i = 0; i < num_products; i++) {
+    products.push_back(std::make_shared<TProduct>(1.0));
+    products.back()->StartSales();
+  }
+
+  auto t0 = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < threads; t++) {
+    workers.emplace_back([&, t]() {
+      std::mt19937 rng(t);
+      std::uniform_int_distribution<size_t> pick(0, num_products - 1);
+      std::uniform_int_distribution<unsigned> permille(0, 999);
+      double sum = 0;
+      for (long i = 0; i < ops; i++) {
+        TProduct& p = *products[pick(rng)];
+        if (permille(rng) >= write_permille) {
+          sum += p.GetPrice();
+          continue;
+        }
+        switch (i % 4) {
+          case 0:
+            p.StopSales();
+            break;
+          case 2:
+            p.StartSales();
+            break;
+          default:
+            p.ChangePrice(1.0 + i % 7);
+        }
+      }
+      volatile double sink = sum;
+      (void)sink;
+    });
+  }
+  for (auto& w: workers) {
+    w.join();
+  }
+  double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  return threads * ops / sec;
+}
+
+int main(int argc, char** argv) {
+  size_t num_products = 4;
+  long ops = 2000000;
+  unsigned max_threads = 32;
+  unsigned write_permille = 10;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--products" && i + 1 < argc) {
+      num_products = std::atol(argv[++i]);
+    } else if (arg == "--ops" && i + 1 < argc) {
+      ops = std::atol(argv[++i]);
+    } else if (arg == "--max-threads" && i + 1 < argc) {
+      max_threads = std::atoi(argv[++i]);
+    } else if (arg == "--write-permille" && i + 1 < argc) {
+      write_permille = std::atoi(argv[++i]);
+    } else {
+      std::cerr << "usage: bench_price [--products N] [--ops K] [--max-threads T] [--write-permille W]"
+                << std::endl;
+      return 1;
+    }
+  }
+
+  std::cout << num_products << " products, " << ops << " operations per thread, " << write_permille
+            << "/1000 writes, hardware threads: " << std::thread::hardware_concurrency() << std::endl;
+  std::cout << std::setw(8) << "threads" << std::setw(16) << "seqlock ops/s" << std::setw(16)
+            << "mutex ops/s" << std::setw(10) << "speedup" << std::endl;
+
+  for (unsigned t = 1; t <= max_threads; t *= 2) {
+    double seqlock = OpsPerSec<ProductBase>(num_products, t, ops, write_permille);
+    double mutex = OpsPerSec<MutexProduct>(num_products, t, ops, write_permille);
+    std::cout << std::setw(8) << t << std::setw(16) << uint64_t(seqlock) << std::setw(16)
+              << uint64_t(mutex) << std::setw(10) << std::fixed << std::setprecision(2)
+              << seqlock / mutex << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,147 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catalog.h"
+#include "product.h"
+#include "shop.h"
+
+// Sell() throughput against the number of selling threads: the RCU catalog of ShopBase
+// against the same hash catalog behind the shop-wide mutex.
+//
+//   ./bench_sell [--products N] [--sells K] [--max-threads T] [--churn]
+//
+// Every thread sells K random products by ID. With --churn another thread keeps removing and
+// re-adding products while the sellers run.
+
+class MutexShop : public IShop {
+ public:
+  ShopId GetId() const override {
+    return 0;  // never attached to a product
+  }
+
+  void AddProduct(IProductPtr prod) override {
+    std::lock_guard<std::mutex> g(mutex_);
+    products_.Insert(prod->GetId(), prod);
+  }
+
+  void RemoveProduct(IProductPtr prod) override {
+    std::lock_guard<std::mutex> g(mutex_);
+    products_.Erase(prod->GetId());
+  }
+
+  double Sell(IProductWeakPtr w_prod) override {
+    IProductPtr prod = w_prod.lock();
+    return prod ? Sell(prod->GetId()) : -1.0;
+  }
+
+  double Sell(ProductId id) override {
+    IProductPtr prod;
+    {
+      std::lock_guard<std::mutex> g(mutex_);
+      const ProductCatalog::Entry* entry = products_.Find(id);
+      if (!entry || !(prod = entry->product.lock())) {
+        return -1.0;
+      }
+    }
+    return prod->GetPrice();
+  }
+
+ private:
+  std::mutex mutex_;
+  ProductCatalog products_;
+};
+
+template<class TShop>
+double SellsPerSec(const std::vector<ProductBasePtr>& products, unsigned threads, long sells, bool churn) {
+  auto shop = std::make_shared<TShop>();
+  for (auto& p: products) {
+    shop->AddProduct(p);
+  }
+
+  std::atomic_bool stop(false);
+  std::thread churner;
+  if (churn) {
+    churner = std::thread([&]() {
+      for (size_t i = 0; !stop; i = (i + 1) % products.size()) {
+        shop->RemoveProduct(products[i]);
+        shop->AddProduct(products[i]);
+      }
+    });
+  }
+
+  auto t0 = std::chrono::steady_clock::now();
+  std::vector<std::thread> sellers;
+  for (unsigned t = 0; t < threads; t++) {
+    sellers.emplace_back([&, t]() {
+      std::mt19937_64 rng(t);
+      std::uniform_int_distribution<size_t> pick(0, products.size() - 1);
+      double sum = 0;
+      for (long i = 0; i < sells; i++) {
+        sum += shop->Sell(products[pick(rng)]->GetId());
+      }
+      volatile double sink = sum;
+      (void)sink;
+    });
+  }
+  for (auto& s: sellers) {
+    s.join();
+  }
+  double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+  stop = true;
+  if (churner.joinable()) {
+    churner.join();
+  }
+  return threads * sells / sec;
+}
+
+int main(int argc, char** argv) {
+  size_t num_products = 10000;
+  long sells = 1000000;
+  unsigned max_threads = 32;
+  bool churn = false;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--products" && i + 1 < argc) {
+      num_products = std::atol(argv[++i]);
+    } else if (arg == "--sells" && i + 1 < argc) {
+      sells = std::atol(argv[++i]);
+    } else if (arg == "--max-threads" && i + 1 < argc) {
+      max_threads = std::atoi(argv[++i]);
+    } else if (arg == "--churn") {
+      churn = true;
+    } else {
+      std::cerr << "usage: bench_sell [--products N] [--sells K] [--max-threads T] [--churn]" << std::endl;
+      return 1;
+    }
+  }
+
+  std::vector<ProductBasePtr> products;
+  for (size_t i = 0; i < num_products; i++) {
+    products.push_back(std::make_shared<ProductBase>(1.0));
+    products.back()->StartSales();
+  }
+
+  std::cout << num_products << " products, " << sells << " sells per thread"
+            << (churn ? ", catalog churn" : "") << ", hardware threads: "
+            << std::thread::hardware_concurrency() << std::endl;
+  std::cout << std::setw(8) << "threads" << std::setw(16) << "rcu sells/s" << std::setw(16)
+            << "mutex sells/s" << std::setw(10) << "speedup" << std::endl;
+
+  for (unsigned t = 1; t <= max_threads; t *= 2) {
+    double rcu = SellsPerSec<ShopBase>(products, t, sells, churn);
+    double mutex = SellsPerSec<MutexShop>(products, t, sells, churn);
+    std::cout << std::setw(8) << t << std::setw(16) << uint64_t(rcu) << std::setw(16) << uint64_t(mutex)
+              << std::setw(10) << std::fixed << std::setprecision(2) << rcu / mutex << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "product.h"
+#include "shop.h"
+
+// One shop under threads that sell by ID and now and then relist a product (remove and add
+// it again), for 1 to 64 threads and several shard counts. Products are picked uniformly or
+// by a Zipfian law, where the hot products concentrate their edits in a few shards.
+//
+//   ./bench_shards [--products N] [--ops K] [--max-threads T] [--write-permille W]
+//                  [--zipf-s S] [--shards A,B,...]
+
+// product indices drawn ahead, so the timed loop doesn't pay for the sampling
+std::vector<uint32_t> Picks(size_t num_products, size_t count, double zipf_s, unsigned seed) {
+  std::mt19937_64 rng(seed);
+  std::vector<uint32_t> picks(count);
+  if (zipf_s <= 0) {
+    std::uniform_int_distribution<uint32_t> pick(0, num_products - 1);
+    for (auto& p: picks) {
+      p = pick(rng);
+    }
+    return picks;
+  }
+
+  std::vector<double> cdf(num_products);
+  double sum = 0;
+  for (size_t i = 0; i < num_products; i++) {
+    sum += 1.0 / std::pow(double(i + 1), zipf_s);
+    cdf[i] = sum;
+  }
+  std::uniform_real_distribution<double> u(0, sum);
+  for (auto& p: picks) {
+    p = std::lower_bound(cdf.begin(), cdf.end(), u(rng)) - cdf.begin();
+  }
+  // popularity rank shouldn't follow creation order, which decides the shard
+  std::vector<uint32_t> perm(num_products);
+  for (size_t i = 0; i < num_products; i++) {
+    perm[i] = i;
+  }
+  std::shuffle(perm.begin(), perm.end(), std::mt19937_64(1));
+  for (auto& p: picks) {
+    p = perm[p];
+  }
+  return picks;
+}
+
+double OpsPerSec(const std::vector<ProductBasePtr>& products, size_t shards, unsigned threads, long ops,
+                 unsigned write_permille, double zipf_s) {
+  ShopBasePtr shop(new ShopBase(shards));
+  std::vector<IProductPtr> all(products.begin(), products.end());
+  shop->AddProducts(all);
+
+  std::vector<std::vector<uint32_t>> picks;
+  for (unsigned t = 0; t < threads; t++) {
+    picks.push_back(Picks(products.size(), ops, zipf_s, t));
+  }
+
+  auto t0 = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < threads; t++) {
+    workers.emplace_back([&, t]() {
+      std::mt19937 rng(t);
+      std::uniform_int_distribution<unsigned> permille(0, 999);
+      double sum = 0;
+      for (uint32_t p: picks[t]) {
+        const ProductBasePtr& prod = products[p];
+        if (permille(rng) < write_permille) {
+          shop->RemoveProduct(prod);
+          shop->AddProduct(prod);
+        } else {
+          sum += shop->Sell(prod->GetId());
+        }
+      }
+      volatile double sink = sum;
+      (void)sink;
+    });
+  }
+  for (auto& w: workers) {
+    w.join();
+  }
+  return threads * ops / std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main(int argc, char** argv) {
+  size_t num_products = 100000;
+  long ops = 100000;
+  unsigned max_threads = 64;
+  unsigned write_permille = 10;
+  double zipf_s = 0.99;
+  std::vector<size_t> shard_counts = {1, 8, 64};
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--products" && i + 1 < argc) {
+      num_products = std::atol(argv[++i]);
+    } else if (arg == "--ops" && i + 1 < argc) {
+      ops = std::atol(argv[++i]);
+    } else if (arg == "--max-threads" && i + 1 < argc) {
+      max_threads = std::atoi(argv[++i]);
+    } else if (arg == "--write-permille" && i + 1 < argc) {
+      write_permille = std::atoi(argv[++i]);
+    } else if (arg == "--zipf-s" && i + 1 < argc) {
+      zipf_s = std::atof(argv[++i]);
+    } else if (arg == "--shards" && i + 1 < argc) {
+      shard_counts.clear();
+      for (char* s = argv[++i]; *s;) {
+        shard_counts.push_back(std::strtoul(s, &s, 10));
+        if (*s == ',') {
+          s++;
+        }
+      }
+    } else {
+      std::cerr << "usage: bench_shards [--products N] [--ops K] [--max-threads T] [--write-permille W]"
+                << " [--zipf-s S] [--shards A,B,...]" << std::endl;
+      return 1;
+    }
+  }
+
+  std::vector<ProductBasePtr> products;
+  for (size_t i = 0; i < num_products; i++) {
+    products.push_back(std::make_shared<ProductBase>(1.0));
+    products.back()->StartSales();
+  }
+
+  std::cout << num_products << " products, " << ops << " operations per thread, " << write_permille
+            << "/1000 relists, hardware threads: " << std::thread::hardware_concurrency() << std::endl;
+
+  for (double s: {0.0, zipf_s}) {
+    std::cout << std::endl << (s > 0 ? "zipfian, s = " + std::to_string(s) : std::string("uniform"))
+              << ", ops/s" << std::endl;
+    std::cout << std::setw(8) << "threads";
+    for (size_t shards: shard_counts) {
+      std::cout << std::setw(12) << std::to_string(shards) + " shards";
+    }
+    std::cout << std::endl;
+
+    for (unsigned t = 1; t <= max_threads; t *= 2) {
+      std::cout << std::setw(8) << t;
+      for (size_t shards: shard_counts) {
+        std::cout << std::setw(12) << uint64_t(OpsPerSec(products, shards, t, ops, write_permille, s));
+      }
+      std::cout << std::endl;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,115 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "product.h"
+#include "shop.h"
+#include "stock.h"
+
+// Threads hammering one hot product whose stock runs out halfway through: the lock-free
+// StockCounter against a counter behind a mutex, and whole Sell() calls of a shop holding the
+// product. Every run checks that exactly the stock was sold.
+//
+//   ./bench_stock [--takes K] [--max-threads T]
+
+class MutexCounter {
+ public:
+  explicit MutexCounter(int64_t count) : count_(count) {}
+
+  bool TryTake() {
+    std::lock_guard<std::mutex> g(mutex_);
+    if (count_ <= 0) {
+      return false;
+    }
+    count_--;
+    return true;
+  }
+
+ private:
+  std::mutex mutex_;
+  int64_t count_;
+};
+
+struct Result {
+  double takes_per_sec;
+  bool ok;
+};
+
+template<class F>
+Result Run(unsigned threads, long takes, int64_t stock, F&& take) {
+  std::atomic<int64_t> sold(0);
+  auto t0 = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < threads; t++) {
+    workers.emplace_back([&]() {
+      int64_t mine = 0;
+      for (long i = 0; i < takes; i++) {
+        mine += take();
+      }
+      sold += mine;
+    });
+  }
+  for (auto& w: workers) {
+    w.join();
+  }
+  double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  return {threads * takes / sec, sold == stock};
+}
+
+int main(int argc, char** argv) {
+  long takes = 200000;
+  unsigned max_threads = 64;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--takes" && i + 1 < argc) {
+      takes = std::atol(argv[++i]);
+    } else if (arg == "--max-threads" && i + 1 < argc) {
+      max_threads = std::atoi(argv[++i]);
+    } else {
+      std::cerr << "usage: bench_stock [--takes K] [--max-threads T]" << std::endl;
+      return 1;
+    }
+  }
+
+  ProductBasePtr prod = std::make_shared<ProductBase>(1.0);
+  prod->StartSales();
+  ProductId id = prod->GetId();
+
+  std::cout << "1 hot product, " << takes << " sales per thread, stock for half of them, hardware threads: "
+            << std::thread::hardware_concurrency() << std::endl;
+  std::cout << std::setw(8) << "threads" << std::setw(16) << "cas takes/s" << std::setw(16)
+            << "mutex takes/s" << std::setw(16) << "shop sells/s" << std::endl;
+
+  bool all_ok = true;
+  for (unsigned t = 1; t <= max_threads; t *= 2) {
+    int64_t stock = int64_t(t) * takes / 2;
+
+    StockCounter counter(stock);
+    Result cas = Run(t, takes, stock, [&]() {
+      return counter.TryTake();
+    });
+    MutexCounter locked(stock);
+    Result mutex = Run(t, takes, stock, [&]() {
+      return locked.TryTake();
+    });
+    ShopBasePtr shop(new ShopBase());
+    shop->AddProduct(prod, stock);
+    Result sell = Run(t, takes, stock, [&]() {
+      return shop->Sell(id) > 0;
+    });
+
+    bool ok = cas.ok && mutex.ok && sell.ok;
+    all_ok &= ok;
+    std::cout << std::setw(8) << t << std::setw(16) << uint64_t(cas.takes_per_sec) << std::setw(16)
+              << uint64_t(mutex.takes_per_sec) << std::setw(16) << uint64_t(sell.takes_per_sec)
+              << (ok ? "" : "  OVERSOLD OR UNDERSOLD") << std::endl;
+  }
+  return all_ok ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+#include "catalog.h"
+
+#include <utility>
+
+static size_t RoundUpPow2(size_t n) {
+  size_t p = 2;
+  while (p < n) {
+    p <<= 1;
+  }
+  return p;
+}
+
+static unsigned Log2(size_t n) {
+  unsigned l = 0;
+  while ((size_t(1) << l) < n) {
+    l++;
+  }
+  return l;
+}
+
+ProductCatalog::ProductCatalog(size_t capacity)
+  : slots_(RoundUpPow2(capacity))
+  , mask_(slots_.size() - 1)
+  , shift_(64 - Log2(slots_.size())) {}
+
+bool ProductCatalog::Insert(ProductId id, IProductWeakPtr product, std::shared_ptr<StockCounter> stock) {
+  if (id == 0) {
+    return false;
+  }
+  if ((size_ + 1) * 4 > slots_.size() * 3) {
+    Grow();
+  }
+
+  for (size_t i = Home(id);; i = (i + 1) & mask_) {
+    Slot& s = slots_[i];
+    if (s.id == id) {
+      return false;
+    }
+    if (s.id == 0) {
+      s.id = id;
+      s.product = std::move(product);
+      s.stock = std::move(stock);
+      size_++;
+      return true;
+    }
+  }
+}
+
+bool ProductCatalog::Erase(ProductId id) {
+  if (id == 0) {
+    return false;
+  }
+  size_t i = Home(id);
+  for (;; i = (i + 1) & mask_) {
+    if (slots_[i].id == 0) {
+      return false;
+    }
+    if (slots_[i].id == id) {
+      break;
+    }
+  }
+
+  // backward-shift deletion: move later entries of the run into the hole when the hole lies
+  // between their home slot and where they sit now
+  size_t hole = i;
+  for (size_t j = (i + 1) & mask_; slots_[j].id != 0; j = (j + 1) & mask_) {
+    size_t home = Home(slots_[j].id);
+    if (((j - home) & mask_) >= ((j - hole) & mask_)) {
+      slots_[hole] = std::move(slots_[j]);
+      hole = j;
+    }
+  }
+  slots_[hole].id = 0;
+  slots_[hole].product.reset();
+  slots_[hole].stock.reset();
+  size_--;
+  return true;
+}
+
+const ProductCatalog::Entry* ProductCatalog::Find(ProductId id) const {
+  if (id == 0) {
+    return nullptr;
+  }
+  for (size_t i = Home(id);; i = (i + 1) & mask_) {
+    const Slot& s = slots_[i];
+    if (s.id == id) {
+      return &s;
+    }
+    if (s.id == 0) {
+      return nullptr;
+    }
+  }
+}
+
+void ProductCatalog::Grow() {
+  std::vector<Slot> old(slots_.size() * 2);
+  old.swap(slots_);
+  mask_ = slots_.size() - 1;
+  shift_--;
+  size_ = 0;
+
+  for (Slot& s: old) {
+    // products destroyed while listed are dropped on the way
+    if (s.id != 0 && !s.product.expired()) {
+      Insert(s.id, std::move(s.product), std::move(s.stock));
+    }
+  }
+}
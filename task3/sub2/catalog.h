@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "registry.h"
+#include "stock.h"
+
+class IProduct;
+using IProductWeakPtr = std::weak_ptr<IProduct>;
+
+// Open-addressing hash table from product ID to the product.
+//
+// Linear probing over a power-of-two array of slots, grown at 3/4 load; erase shifts the
+// following entries of the probe run back instead of leaving tombstones, so lookups never
+// slow down as products come and go. A lookup hashes the ID and compares integers: the weak
+// pointers are only copied, never locked. ID 0 marks an empty slot.
+//
+// Not thread-safe for writes; the shop changes only a copy no reader can see.
+class ProductCatalog {
+ public:
+  struct Entry {
+    ProductId id = 0;
+    IProductWeakPtr product;
+    std::shared_ptr<StockCounter> stock;  // may be shared with another catalog
+  };
+
+  explicit ProductCatalog(size_t capacity = 16);
+
+  // false (and no change) if id is already present
+  bool Insert(ProductId id, IProductWeakPtr product, std::shared_ptr<StockCounter> stock = nullptr);
+  // false if id is not present
+  bool Erase(ProductId id);
+  // nullptr if id is not present
+  const Entry* Find(ProductId id) const;
+  // brings the home slot of id into cache ahead of a Find
+  void Prefetch(ProductId id) const {
+    __builtin_prefetch(&slots_[Home(id)]);
+  }
+
+  size_t Size() const {
+    return size_;
+  }
+
+  template<class F>
+  void ForEach(F&& f) const {
+    for (const Slot& s: slots_) {
+      if (s.id != 0) {
+        f(s.id, s.product);
+      }
+    }
+  }
+
+ private:
+  using Slot = Entry;
+
+  size_t Home(ProductId id) const {
+    // Fibonacci hashing: sequential IDs spread over the whole table
+    return size_t((id * 0x9e3779b97f4a7c15ULL) >> shift_);
+  }
+
+  void Grow();
+
+  std::vector<Slot> slots_;
+  size_t mask_;
+  unsigned shift_;
+  size_t size_ = 0;
+};
@@ -2,16 +2,29 @@
 #include "shop.h"
 
 ProductBase::ProductBase(double price)
-  : price_(price)
+  : id_(registry::Register(price))
+  , price_(price)
   , started_(false) {}
 
-ProductBase::~ProductBase() {}
+ProductBase::~ProductBase() {
+  registry::Unregister(id_);
+}
 
 void ProductBase::Attach(IShopWeakPtr w_shop) {
   auto shop = w_shop.lock();
 
   if (shop) {
-    shops_.push_back(shop);
+    std::lock_guard<std::mutex> sg(sales_mutex_);
+    {
+      std::lock_guard<std::mutex> g(shops_mutex_);
+      if (!shop_index_.count(shop->GetId())) {
+        if (shops_.size() == shops_.capacity()) {
+          CompactShops();
+        }
+        shop_index_.emplace(shop->GetId(), shops_.size());
+        shops_.push_back({shop->GetId(), shop});
+      }
+    }
     shop->AddProduct(shared_from_this());
   }
 }
@@ -20,47 +33,92 @@ void ProductBase::Detach(IShopWeakPtr w_shop) {
   auto shop = w_shop.lock();
 
   if (shop) {
-    shops_.remove_if([&w_shop](const IShopWeakPtr& w) {
-      auto lp1 = w.lock();
-      auto lp2 = w_shop.lock();
-      if (!lp1) return true;
-      if (!lp2) return false;
-      return lp1 == lp2;
-    });
+    std::lock_guard<std::mutex> sg(sales_mutex_);
+    {
+      std::lock_guard<std::mutex> g(shops_mutex_);
+      auto f = shop_index_.find(shop->GetId());
+      if (f != shop_index_.end()) {
+        RemoveShopAt(f->second);
+      }
+    }
     shop->RemoveProduct(shared_from_this());
   }
 }
 
+void ProductBase::RemoveShopAt(size_t i) {
+  shop_index_.erase(shops_[i].id);
+  if (i + 1 != shops_.size()) {
+    shops_[i] = std::move(shops_.back());
+    shop_index_[shops_[i].id] = i;
+  }
+  shops_.pop_back();
+}
+
+void ProductBase::CompactShops() {
+  for (size_t i = 0; i < shops_.size();) {
+    if (shops_[i].shop.expired()) {
+      RemoveShopAt(i);
+    } else {
+      i++;
+    }
+  }
+}
+
+void ProductBase::StoreState(double price, bool started) {
+  price_ = price;
+  started_ = started;
+  registry::Store(id_, price, started);
+}
+
 void ProductBase::ChangePrice(double price) {
   std::lock_guard<std::mutex> g(mutex_);
-  price_ = price;
+  StoreState(price, started_);
 }
 
-void ProductBase::StartSales() {
-  started_ = true;
-  for (IShopWeakPtr& w_shop : shops_) {
-    auto shop = w_shop.lock();
+std::vector<std::shared_ptr<IShop>> ProductBase::LiveShops() {
+  std::lock_guard<std::mutex> g(shops_mutex_);
+  std::vector<std::shared_ptr<IShop>> live;
+  live.reserve(shops_.size());
+  for (size_t i = 0; i < shops_.size();) {
+    auto shop = shops_[i].shop.lock();
     if (shop) {
-      shop->AddProduct(shared_from_this());
+      live.push_back(std::move(shop));
+      i++;
+    } else {
+      RemoveShopAt(i);
     }
   }
+  return live;
 }
 
-void ProductBase::StopSales() {
-  started_ = false;
-  for (IShopWeakPtr& w_shop : shops_) {
-    auto shop = w_shop.lock();
-    if (shop) {
-      shop->RemoveProduct(shared_from_this());
-    }
+void ProductBase::StartSales() {
+  std::lock_guard<std::mutex> sg(sales_mutex_);
+  {
+    std::lock_guard<std::mutex> g(mutex_);
+    StoreState(price_, true);
+  }
+  IProductPtr self = shared_from_this();
+  for (auto& shop: LiveShops()) {
+    shop->AddProduct(self);
   }
 }
 
-double ProductBase::GetPrice() const {
-  if (!started_) {
-    return -1.0;
-  } else {
+void ProductBase::StopSales() {
+  std::lock_guard<std::mutex> sg(sales_mutex_);
+  {
     std::lock_guard<std::mutex> g(mutex_);
-    return price_;
+    StoreState(price_, false);
+  }
+  IProductPtr self = shared_from_this();
+  for (auto& shop: LiveShops()) {
+    shop->RemoveProduct(self);
   }
 }
+
+double ProductBase::GetPrice() const {
+  return registry::Price(id_);
+}
+
+ProductId ProductBase::GetId() const {
+  return id_;
+}
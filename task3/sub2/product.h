@@ -1,11 +1,15 @@
 #pragma once
 
-#include <list>
 #include <memory>
 #include <mutex>
 #include <atomic>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "registry.h"
+#include "shop.h"
 
-class IShop;
 using IShopWeakPtr = std::weak_ptr<IShop>;
 
 class IProduct {
@@ -18,6 +22,8 @@ class IProduct {
   virtual void StopSales() = 0;
   virtual void ChangePrice(double price) = 0;
   virtual double GetPrice() const = 0;
+  // a handle in the product registry, which the shops read prices from by ID (registry.h)
+  virtual ProductId GetId() const = 0;
 };
 
 class ProductBase : public IProduct, public std::enable_shared_from_this<ProductBase> {
@@ -31,12 +37,40 @@ class ProductBase : public IProduct, public std::enable_shared_from_this<Product
   void StopSales() override;
   void ChangePrice(double price) override;
   double GetPrice() const override;
+  ProductId GetId() const override;
 
  private:
-  std::list<IShopWeakPtr> shops_;
+  struct ShopSlot {
+    ShopId id;
+    IShopWeakPtr shop;
+  };
+
+  void StoreState(double price, bool started);  // under mutex_
+  // takes shops_mutex_: the shops still alive, dropping the destroyed ones
+  std::vector<std::shared_ptr<IShop>> LiveShops();
+  // under shops_mutex_
+  void RemoveShopAt(size_t i);
+  void CompactShops();
+
+  const ProductId id_;
+
+  // the shops carrying the product, unordered, and where each one sits in shops_: attach
+  // appends, detach moves the last slot into the hole. Shops destroyed meanwhile are dropped
+  // when StartSales/StopSales meet them and before shops_ would reallocate.
+  std::mutex shops_mutex_;
+  std::vector<ShopSlot> shops_;
+  std::unordered_map<ShopId, size_t> shop_index_;
+
+  // Attach, Detach, StartSales and StopSales call the shops outside shops_mutex_, since every
+  // call waits for the shop's readers; this keeps two of them from reaching a shop in the
+  // other order
+  std::mutex sales_mutex_;
+
+  // price_ and started_ are the writers' copy of the state published in the registry slot of
+  // id_, which GetPrice and the shops read
+  std::mutex mutex_;
   double price_;
-  mutable std::mutex mutex_;
-  std::atomic_bool started_;
+  bool started_;
 };
 
 using ProductBasePtr = std::shared_ptr<ProductBase>;
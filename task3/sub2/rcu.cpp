@@ -0,0 +1,98 @@
+#include "rcu.h"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rcu {
+
+namespace {
+
+// one per thread that ever read, reused after the thread exits
+struct alignas(64) Record {
+  std::atomic<uint64_t> epoch{0};  // 0: not in a read section
+  unsigned nesting = 0;            // owner only
+  bool in_use = false;             // under records_mutex
+};
+
+std::atomic<uint64_t> global_epoch{1};
+std::mutex records_mutex;
+std::deque<Record> records;  // never shrinks, so Record addresses are stable
+
+struct LocalRecord {
+  LocalRecord() {
+    std::lock_guard<std::mutex> g(records_mutex);
+    for (Record& r: records) {
+      if (!r.in_use) {
+        record = &r;
+        break;
+      }
+    }
+    if (!record) {
+      record = &records.emplace_back();
+    }
+    record->in_use = true;
+  }
+
+  ~LocalRecord() {
+    std::lock_guard<std::mutex> g(records_mutex);
+    record->in_use = false;
+  }
+
+  Record* record = nullptr;
+};
+
+Record& Local() {
+  thread_local LocalRecord local;
+  return *local.record;
+}
+
+}  // namespace
+
+ReadGuard::ReadGuard() {
+  Record& r = Local();
+  if (r.nesting++ == 0) {
+    // seq_cst: a writer's scan either sees this store or its pointer swap is visible to the
+    // loads that follow
+    r.epoch.store(global_epoch.load(std::memory_order_relaxed), std::memory_order_seq_cst);
+  }
+}
+
+ReadGuard::~ReadGuard() {
+  Record& r = Local();
+  if (--r.nesting == 0) {
+    r.epoch.store(0, std::memory_order_release);
+  }
+}
+
+void Synchronize() {
+  uint64_t target = global_epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+
+  // Spin on a snapshot, not under the mutex, so threads registering their first read don't
+  // wait for us. A record claimed after the snapshot belongs to a thread that reads the epoch
+  // only after taking the mutex, so it announces target or later.
+  std::vector<Record*> active;
+  {
+    std::lock_guard<std::mutex> g(records_mutex);
+    for (Record& r: records) {
+      if (r.in_use) {
+        active.push_back(&r);
+      }
+    }
+  }
+  for (Record* r: active) {
+    // a reader that announced an epoch >= target started after the new version was published
+    for (;;) {
+      uint64_t e = r->epoch.load(std::memory_order_seq_cst);
+      if (e == 0 || e >= target) {
+        break;
+      }
+      std::this_thread::yield();
+    }
+  }
+}
+
+}  // namespace rcu
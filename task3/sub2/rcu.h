@@ -0,0 +1,26 @@
+#pragma once
+
+// Epoch-based read-copy-update, process-wide.
+//
+// Readers bracket their access to shared data with a ReadGuard. Entering one stores the
+// current epoch into the thread's own cache line and leaving stores 0, so readers never write
+// memory another thread writes and never wait. A writer publishes a new version with an
+// atomic pointer store and then calls Synchronize(), which returns once every read section
+// that might still see the old version has ended; the old version may be reused or freed
+// after that.
+//
+// Read sections nest and must not call Synchronize().
+namespace rcu {
+
+class ReadGuard {
+ public:
+  ReadGuard();
+  ~ReadGuard();
+
+  ReadGuard(const ReadGuard&) = delete;
+  ReadGuard& operator=(const ReadGuard&) = delete;
+};
+
+void Synchronize();
+
+}  // namespace rcu
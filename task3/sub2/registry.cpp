@@ -0,0 +1,143 @@
+#include "registry.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+namespace registry {
+
+namespace {
+
+// one cache line per product, so selling one never misses on another's price change
+struct alignas(64) Slot {
+  std::atomic<uint32_t> seq{0};  // odd while a write is in progress
+  std::atomic<uint32_t> generation{1};
+  std::atomic<double> price{0};
+  std::atomic_bool started{false};
+  uint32_t next_free = 0;  // under mutex
+};
+
+constexpr unsigned kChunkBits = 12;
+constexpr uint32_t kChunkSize = 1u << kChunkBits;
+constexpr uint32_t kMaxChunks = 1u << (32 - kChunkBits);
+constexpr uint32_t kNoSlot = ~0u;
+
+std::atomic<Slot*> chunks[kMaxChunks];  // filled in order, never freed
+
+std::mutex mutex;
+uint32_t free_head = kNoSlot;
+uint32_t slots_used = 0;
+
+uint32_t IndexOf(ProductId id) {
+  return uint32_t(id);
+}
+
+uint32_t GenerationOf(ProductId id) {
+  return uint32_t(id >> 32);
+}
+
+// nullptr for an index never handed out
+Slot* Find(uint32_t index) {
+  Slot* chunk = chunks[index >> kChunkBits].load(std::memory_order_acquire);
+  return chunk ? &chunk[index & (kChunkSize - 1)] : nullptr;
+}
+
+// writers of one slot are serialized by the caller
+template<class F>
+void Write(Slot& s, F&& f) {
+  uint32_t seq = s.seq.load(std::memory_order_relaxed);
+  s.seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  f();
+  s.seq.store(seq + 2, std::memory_order_release);
+}
+
+struct State {
+  uint32_t generation;
+  double price;
+  bool started;
+};
+
+State Read(const Slot& s) {
+  for (;;) {
+    uint32_t seq = s.seq.load(std::memory_order_acquire);
+    if (seq & 1) {
+      std::this_thread::yield();  // a writer is in the middle of an update
+      continue;
+    }
+    State st{s.generation.load(std::memory_order_relaxed), s.price.load(std::memory_order_relaxed),
+             s.started.load(std::memory_order_relaxed)};
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (s.seq.load(std::memory_order_relaxed) == seq) {
+      return st;
+    }
+  }
+}
+
+}  // namespace
+
+ProductId Register(double price) {
+  std::lock_guard<std::mutex> g(mutex);
+
+  uint32_t index;
+  if (free_head != kNoSlot) {
+    index = free_head;
+    free_head = Find(index)->next_free;
+  } else {
+    index = slots_used++;
+    if ((index & (kChunkSize - 1)) == 0) {
+      chunks[index >> kChunkBits].store(new Slot[kChunkSize], std::memory_order_release);
+    }
+  }
+
+  Slot& s = *Find(index);
+  Write(s, [&]() {
+    s.price.store(price, std::memory_order_relaxed);
+    s.started.store(false, std::memory_order_relaxed);
+  });
+  return ProductId(s.generation.load(std::memory_order_relaxed)) << 32 | index;
+}
+
+void Unregister(ProductId id) {
+  std::lock_guard<std::mutex> g(mutex);
+
+  Slot& s = *Find(IndexOf(id));
+  Write(s, [&]() {
+    uint32_t generation = GenerationOf(id) + 1;
+    s.generation.store(generation != 0 ? generation : 1, std::memory_order_relaxed);
+    s.started.store(false, std::memory_order_relaxed);
+  });
+  s.next_free = free_head;
+  free_head = IndexOf(id);
+}
+
+void Store(ProductId id, double price, bool started) {
+  Slot& s = *Find(IndexOf(id));
+  Write(s, [&]() {
+    s.price.store(price, std::memory_order_relaxed);
+    s.started.store(started, std::memory_order_relaxed);
+  });
+}
+
+double Price(ProductId id) {
+  const Slot* s = Find(IndexOf(id));
+  if (!s) {
+    return -1.0;
+  }
+  State st = Read(*s);
+  return st.generation == GenerationOf(id) && st.started ? st.price : -1.0;
+}
+
+bool Alive(ProductId id) {
+  const Slot* s = Find(IndexOf(id));
+  return s && s->generation.load(std::memory_order_acquire) == GenerationOf(id);
+}
+
+void Prefetch(ProductId id) {
+  const Slot* s = Find(IndexOf(id));
+  if (s) {
+    __builtin_prefetch(s);
+  }
+}
+
+}  // namespace registry
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+using ProductId = uint64_t;
+
+// Process-wide slot map of product price states, addressed by ProductId.
+//
+// A ProductId is a handle: the slot index in the low 32 bits and the slot's generation in
+// the high 32 bits. Unregistering bumps the generation, so every ID handed out for the slot
+// before goes stale, and the slot is reused. Slots live in fixed chunks that are never
+// freed, so a reader needs no ownership of the product: it checks the generation and reads
+// the price with plain loads under the slot's seqlock, and a stale ID reads as not for sale.
+//
+// Generations start at 1, so no ID is 0.
+namespace registry {
+
+// a new ID for a product that is not on sale yet
+ProductId Register(double price);
+// id goes stale; the product must not Store() after this
+void Unregister(ProductId id);
+
+// publishes the price state of a registered product; stores for one ID must not overlap
+void Store(ProductId id, double price, bool started);
+
+// the price if id is live and on sale, -1 otherwise
+double Price(ProductId id);
+bool Alive(ProductId id);
+// brings the slot of id into cache ahead of a Price
+void Prefetch(ProductId id);
+
+}  // namespace registry
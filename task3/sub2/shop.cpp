@@ -1,28 +1,293 @@
 #include "shop.h"
 #include "product.h"
+#include "rcu.h"
+#include "registry.h"
+
+#include <algorithm>
+
+static ShopId NextShopId() {
+  static std::atomic<ShopId> next(1);
+  return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+static size_t RoundUpPow2(size_t n) {
+  size_t p = 1;
+  while (p < n) {
+    p <<= 1;
+  }
+  return p;
+}
+
+ShopBase::ShopBase(size_t shards)
+  : id_(NextShopId())
+  , shard_mask_(RoundUpPow2(shards) - 1)
+  , shards_(new Shard[shard_mask_ + 1]) {}
+
+ShopId ShopBase::GetId() const {
+  return id_;
+}
+
+ShopBase::Batch::Batch(ShopBase& shop) : shop_(shop) {
+  shop_.LockShards();
+  for (size_t i = 0; i <= shop_.shard_mask_; i++) {
+    shop_.shards_[i].batches++;
+  }
+  shop_.UnlockShards();
+}
+
+ShopBase::Batch::~Batch() {
+  shop_.LockShards();
+  for (size_t i = 0; i <= shop_.shard_mask_; i++) {
+    shop_.shards_[i].batches--;
+  }
+  if (shop_.shards_[0].batches == 0) {
+    shop_.PublishShards();
+  }
+  shop_.UnlockShards();
+}
 
 void ShopBase::AddProduct(IProductPtr prod) {
-  std::lock_guard<std::mutex> g(mutex_);
-  products_.insert(prod);
+  Queue(prod->GetId(), prod);
+}
+
+void ShopBase::AddProduct(IProductPtr prod, int64_t stock) {
+  Queue(prod->GetId(), prod, stock);
 }
 
 void ShopBase::RemoveProduct(IProductPtr prod) {
-  std::lock_guard<std::mutex> g(mutex_);
-  products_.erase(products_.find(prod));
+  Queue(prod->GetId(), IProductWeakPtr());
 }
 
-double ShopBase::Sell(IProductWeakPtr w_prod) {
-  IProductPtr prod;
+void ShopBase::AddProducts(std::span<const IProductPtr> prods) {
+  LockShards();
+  for (const IProductPtr& prod: prods) {
+    Shard& shard = ShardOf(prod->GetId());
+    shard.pending.push_back({prod->GetId(), prod, shard.Counter(prod->GetId())});
+  }
+  if (shards_[0].batches == 0) {
+    PublishShards();
+  }
+  UnlockShards();
+}
+
+std::vector<ProductId> ShopBase::ListProducts() {
+  std::vector<ProductId> ids;
+  LockShards();
+  for (size_t i = 0; i <= shard_mask_; i++) {
+    shards_[i].products.load(std::memory_order_relaxed)->ForEach(
+        [&ids](ProductId id, const IProductWeakPtr& product) {
+          if (!product.expired()) {
+            ids.push_back(id);
+          }
+        });
+  }
+  UnlockShards();
+  return ids;
+}
+
+void ShopBase::Queue(ProductId id, IProductWeakPtr product, std::optional<int64_t> stock) {
+  Shard& shard = ShardOf(id);
+  std::lock_guard<std::mutex> g(shard.mutex);
+  std::shared_ptr<StockCounter> counter;
+  if (!product.expired()) {
+    counter = shard.Counter(id);
+    if (stock) {
+      // a listed product shares the counter, so its stock changes right away
+      counter->Set(*stock);
+    }
+  }
+  shard.pending.push_back({id, std::move(product), std::move(counter)});
+  if (shard.batches == 0 && shard.Swap()) {
+    rcu::Synchronize();
+    shard.Replay();
+  }
+}
+
+void ShopBase::LockShards() {
+  for (size_t i = 0; i <= shard_mask_; i++) {
+    shards_[i].mutex.lock();
+  }
+}
+
+void ShopBase::UnlockShards() {
+  for (size_t i = shard_mask_ + 1; i-- > 0;) {
+    shards_[i].mutex.unlock();
+  }
+}
+
+void ShopBase::PublishShards() {
+  // one grace period for all the shards
+  bool swapped = false;
+  for (size_t i = 0; i <= shard_mask_; i++) {
+    swapped |= shards_[i].Swap();
+  }
+  if (swapped) {
+    rcu::Synchronize();
+  }
+  for (size_t i = 0; i <= shard_mask_; i++) {
+    shards_[i].Replay();
+  }
+}
+
+bool ShopBase::Shard::Swap() {
+  if (pending.empty()) {
+    return false;
+  }
+
+  const ProductCatalog* current = products.load(std::memory_order_relaxed);
+  ProductCatalog* standby = current == &catalogs[0] ? &catalogs[1] : &catalogs[0];
 
-  {
-    std::lock_guard<std::mutex> g(mutex_);
-    auto f = products_.find(w_prod);
-    if (f != products_.end()) {
-      prod = w_prod.lock();
+  for (const CatalogEdit& e: pending) {
+    // a product destroyed before its batch closed is dropped as well
+    if (e.product.expired()) {
+      standby->Erase(e.id);
     } else {
-      return -1.0;
+      standby->Insert(e.id, e.product, e.stock);
     }
   }
+  products.store(standby, std::memory_order_seq_cst);
+  return true;
+}
+
+std::shared_ptr<StockCounter> ShopBase::Shard::Counter(ProductId id) {
+  std::shared_ptr<StockCounter>& counter = stock[id];
+  if (!counter) {
+    counter = std::make_shared<StockCounter>();
+    if (stock.size() >= prune_at) {
+      // an ID goes stale for good when its product is destroyed; id itself is live, so its
+      // entry stays
+      std::erase_if(stock, [](const auto& kv) {
+        return !registry::Alive(kv.first);
+      });
+      prune_at = std::max<size_t>(64, stock.size() * 2);
+    }
+  }
+  return counter;
+}
+
+void ShopBase::Shard::Replay() {
+  // the copy that was published before Swap, no longer seen by any reader
+  const ProductCatalog* current = products.load(std::memory_order_relaxed);
+  ProductCatalog* old = current == &catalogs[0] ? &catalogs[1] : &catalogs[0];
+  for (CatalogEdit& e: pending) {
+    if (e.product.expired()) {
+      old->Erase(e.id);
+    } else {
+      old->Insert(e.id, std::move(e.product), std::move(e.stock));
+    }
+  }
+  pending.clear();
+}
+
+// price is -1 if the product is not for sale
+static double TakeOne(const ProductCatalog::Entry& entry, double price) {
+  return price >= 0 && entry.stock->TryTake() ? price : -1.0;
+}
+
+double ShopBase::Sell(IProductWeakPtr w_prod) {
+  IProductPtr prod = w_prod.lock();
+  if (!prod) {
+    return -1.0;
+  }
+
+  rcu::ReadGuard g;
+  const ProductCatalog::Entry* entry = Listed(prod->GetId());
+  return entry ? TakeOne(*entry, prod->GetPrice()) : -1.0;
+}
+
+double ShopBase::Sell(ProductId id) {
+  rcu::ReadGuard g;
+  const ProductCatalog::Entry* entry = Listed(id);
+  // an entry of a destroyed product stays until the catalog grows past it; its ID is stale
+  return entry ? TakeOne(*entry, registry::Price(id)) : -1.0;
+}
+
+void ShopBase::SellBatch(std::span<const ProductId> ids, std::span<double> prices_out) {
+  ids = ids.first(std::min(ids.size(), prices_out.size()));
+
+  // looked up a chunk at a time: catalog slots are prefetched a few IDs ahead, then the
+  // registry slot and stock of every product of the chunk are prefetched before the first
+  // price is read
+  constexpr size_t kChunk = 16;
+  constexpr size_t kPrefetchAhead = 4;
+  const ProductCatalog::Entry* entries[kChunk];
+
+  rcu::ReadGuard g;
+  auto catalog = [this](ProductId id) {
+    return ShardOf(id).products.load(std::memory_order_seq_cst);
+  };
+
+  for (size_t i = 0; i < kPrefetchAhead && i < ids.size(); i++) {
+    catalog(ids[i])->Prefetch(ids[i]);
+  }
+
+  for (size_t begin = 0; begin < ids.size(); begin += kChunk) {
+    size_t end = std::min(begin + kChunk, ids.size());
+
+    for (size_t i = begin; i < end; i++) {
+      if (i + kPrefetchAhead < ids.size()) {
+        catalog(ids[i + kPrefetchAhead])->Prefetch(ids[i + kPrefetchAhead]);
+      }
+      const ProductCatalog::Entry* entry = entries[i - begin] = catalog(ids[i])->Find(ids[i]);
+      if (entry) {
+        registry::Prefetch(ids[i]);
+        __builtin_prefetch(entry->stock.get());
+      }
+    }
+
+    for (size_t i = begin; i < end; i++) {
+      const ProductCatalog::Entry* entry = entries[i - begin];
+      prices_out[i] = entry ? TakeOne(*entry, registry::Price(ids[i])) : -1.0;
+    }
+  }
+}
+
+bool ShopBase::SellBasket(std::span<const ProductId> ids, std::span<double> prices_out) {
+  if (prices_out.size() < ids.size()) {
+    return false;
+  }
+
+  // the counters taken from; entries seen in a read section stay valid until it ends, but a
+  // second lookup might find the product delisted
+  thread_local std::vector<StockCounter*> taken;
+  taken.clear();
+
+  rcu::ReadGuard g;
+  for (size_t i = 0; i < ids.size(); i++) {
+    const ProductCatalog::Entry* entry = Listed(ids[i]);
+    double price = entry ? registry::Price(ids[i]) : -1.0;
+    if (price < 0 || !entry->stock->TryTake()) {
+      for (StockCounter* stock: taken) {
+        stock->Put(1);
+      }
+      return false;
+    }
+    taken.push_back(entry->stock.get());
+    prices_out[i] = price;
+  }
+  return true;
+}
+
+bool ShopBase::SetStock(ProductId id, int64_t count) {
+  rcu::ReadGuard g;
+  const ProductCatalog::Entry* entry = Listed(id);
+  if (!entry) {
+    return false;
+  }
+  return entry->stock->Set(count);
+}
+
+bool ShopBase::Restock(ProductId id, int64_t count) {
+  rcu::ReadGuard g;
+  const ProductCatalog::Entry* entry = Listed(id);
+  if (!entry) {
+    return false;
+  }
+  return entry->stock->Put(count);
+}
 
-  return prod->GetPrice();
+int64_t ShopBase::Stock(ProductId id) {
+  rcu::ReadGuard g;
+  const ProductCatalog::Entry* entry = Listed(id);
+  return entry ? entry->stock->Count() : -1;
 }
@@ -1,44 +1,158 @@
 #pragma once
 
+#include <atomic>
 #include <memory>
-#include <set>
 #include <mutex>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "catalog.h"
 
 class IProduct;
 using IProductPtr = std::shared_ptr<IProduct>;
 using IProductWeakPtr = std::weak_ptr<IProduct>;
 
+// unique for the life of the process, never 0
+using ShopId = uint64_t;
+
 class IShop {
  public:
   virtual ~IShop() {}
 
+  virtual ShopId GetId() const = 0;
+
   virtual void AddProduct(IProductPtr prod) = 0;
   virtual void RemoveProduct(IProductPtr prod) = 0;
   virtual double Sell(IProductWeakPtr prod) = 0;
-};
-
-class weak_ptr_comp {
- public:
-  bool operator() (const IProductWeakPtr& p1, const IProductWeakPtr& p2) const {
-    auto lp1 = p1.lock(), lp2 = p2.lock();
+  virtual double Sell(ProductId id) = 0;
 
-    if (!lp2) return false;
-    if (!lp1) return true;
-    return lp1 < lp2;
+  // Sells every product of a basket: prices_out[i] is what Sell(ids[i]) would return. If
+  // prices_out is shorter than ids, only the products it has room for are sold.
+  virtual void SellBatch(std::span<const ProductId> ids, std::span<double> prices_out) {
+    for (size_t i = 0; i < ids.size() && i < prices_out.size(); i++) {
+      prices_out[i] = Sell(ids[i]);
+    }
   }
 };
 
+// Sell() takes no lock: it looks the product up in the published catalog inside an RCU read
+// section. Selling by ID reads the price from the product registry and never touches the
+// product itself, so products sold by ID must keep their price there, as ProductBase does.
+//
+// The catalog is split into shards by product ID, each with its own writer lock, so edits of
+// different shards don't wait for each other. Every shard keeps its catalog twice. A writer
+// applies its edits to the standby copy, publishes it with one pointer store, waits out the
+// readers of the old copy (rcu::Synchronize) and replays the edits onto it, so a reader only
+// ever sees a copy that nobody is changing. Edits made while a Batch is open are published
+// together when the last open batch closes; on their own they are published before
+// AddProduct/RemoveProduct returns.
+//
+// AddProducts, Batch and ListProducts lock every shard in shard order: a listing sees either
+// all or none of a bulk import or a batch. A seller sees each shard switch on its own.
+//
+// Every listed product has a stock counter, unlimited unless given; both catalog copies share
+// it. The shard keeps the counter when the product is delisted, so a product relisted (as
+// StopSales/StartSales do) carries on with the stock it had left. A sale takes one item with a
+// compare-and-swap inside the read section, so stock is never oversold and a sold-out product
+// fails without writing anything.
 class ShopBase : public IShop, public std::enable_shared_from_this<ShopBase> {
  public:
-  ShopBase() {}
+  static constexpr size_t kDefaultShards = 8;
 
+  // shards is rounded up to a power of two
+  explicit ShopBase(size_t shards = kDefaultShards);
+
+  ShopId GetId() const override;
   void AddProduct(IProductPtr prod) override;
   void RemoveProduct(IProductPtr prod) override;
   double Sell(IProductWeakPtr prod) override;
+  double Sell(ProductId id) override;
+  // the whole basket is looked up in one RCU read section
+  void SellBatch(std::span<const ProductId> ids, std::span<double> prices_out) override;
+
+  // lists prod if it is not listed yet, and sets its stock to stock items either way; a
+  // negative stock leaves the stock as it was
+  void AddProduct(IProductPtr prod, int64_t stock);
+  // bulk import, published at once
+  void AddProducts(std::span<const IProductPtr> prods);
+
+  // false if id is not listed or count < 0; StockCounter::kUnlimited lifts the limit, and
+  // a restock that would reach it does too
+  bool SetStock(ProductId id, int64_t count);
+  bool Restock(ProductId id, int64_t count);
+  // -1 if id is not listed
+  int64_t Stock(ProductId id);
+  // sells every product of the basket or none: false, with every item taken so far put back,
+  // if one of them is not for sale or sold out, or prices_out is shorter than ids;
+  // prices_out holds the prices on success
+  bool SellBasket(std::span<const ProductId> ids, std::span<double> prices_out);
+
+  // IDs of the products listed and not destroyed, in no particular order
+  std::vector<ProductId> ListProducts();
+  size_t Shards() const {
+    return shard_mask_ + 1;
+  }
+
+  class Batch {
+   public:
+    explicit Batch(ShopBase& shop);
+    ~Batch();
+
+    Batch(const Batch&) = delete;
+    Batch& operator=(const Batch&) = delete;
+
+   private:
+    ShopBase& shop_;
+  };
 
  private:
-  std::mutex mutex_;
-  std::set<IProductWeakPtr, weak_ptr_comp> products_;
+  struct CatalogEdit {
+    ProductId id;
+    IProductWeakPtr product;  // empty: remove
+    std::shared_ptr<StockCounter> stock;
+  };
+
+  struct alignas(64) Shard {
+    Shard() : products(&catalogs[0]) {}
+
+    // under mutex: Publish is Swap, rcu::Synchronize, Replay
+    bool Swap();
+    void Replay();
+    // under mutex: the counter kept for id, unlimited if it had none
+    std::shared_ptr<StockCounter> Counter(ProductId id);
+
+    std::mutex mutex;  // writers
+    ProductCatalog catalogs[2];
+    std::atomic<const ProductCatalog*> products;
+    std::vector<CatalogEdit> pending;
+    unsigned batches = 0;
+    // the counters of every product listed here, delisted ones included; those of destroyed
+    // products are dropped each time it doubles
+    std::unordered_map<ProductId, std::shared_ptr<StockCounter>> stock;
+    size_t prune_at = 64;
+  };
+
+  Shard& ShardOf(ProductId id) const {
+    // the low bits of the registry slot index, which is handed out in order
+    return shards_[id & shard_mask_];
+  }
+
+  // in a read section
+  const ProductCatalog::Entry* Listed(ProductId id) const {
+    return ShardOf(id).products.load(std::memory_order_seq_cst)->Find(id);
+  }
+
+  // an empty product removes; stock, if given, is set on the product's counter
+  void Queue(ProductId id, IProductWeakPtr product, std::optional<int64_t> stock = std::nullopt);
+  void LockShards();
+  void UnlockShards();
+  void PublishShards();  // under every shard lock
+
+  const ShopId id_;
+  const size_t shard_mask_;
+  std::unique_ptr<Shard[]> shards_;
 };
 
 using ShopBasePtr = std::shared_ptr<ShopBase>;
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+
+// Items of one product left in one shop.
+//
+// Taking is a compare-and-swap that only succeeds while enough items are left, so the count
+// never goes below zero however many sellers race for the last item. A sold-out counter
+// fails on the first load, and an unlimited one is only ever read.
+class StockCounter {
+ public:
+  static constexpr int64_t kUnlimited = std::numeric_limits<int64_t>::max();
+
+  explicit StockCounter(int64_t count = kUnlimited) : count_(count) {}
+
+  // false (and no change) if fewer than n items are left
+  bool TryTake(int64_t n = 1) {
+    int64_t c = count_.load(std::memory_order_acquire);
+    for (;;) {
+      if (c == kUnlimited) {
+        return true;
+      }
+      if (c < n) {
+        return false;
+      }
+      if (count_.compare_exchange_weak(c, c - n, std::memory_order_acq_rel, std::memory_order_acquire)) {
+        return true;
+      }
+    }
+  }
+
+  // restocks, or gives back what TryTake took; false (and no change) if n < 0. Unlimited
+  // stays unlimited, and a count that would reach kUnlimited becomes unlimited.
+  bool Put(int64_t n) {
+    if (n < 0) {
+      return false;
+    }
+    int64_t c = count_.load(std::memory_order_relaxed);
+    while (c != kUnlimited) {
+      int64_t next = c >= kUnlimited - n ? kUnlimited : c + n;
+      if (count_.compare_exchange_weak(c, next, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    return true;
+  }
+
+  // false (and no change) if count < 0
+  bool Set(int64_t count) {
+    if (count < 0) {
+      return false;
+    }
+    count_.store(count, std::memory_order_release);
+    return true;
+  }
+
+  int64_t Count() const {
+    return count_.load(std::memory_order_acquire);
+  }
+
+ private:
+  alignas(64) std::atomic<int64_t> count_;
+};
@@ -1,5 +1,10 @@
 #include "lest.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
 #include "product.h"
 #include "shop.h"
 
@@ -49,6 +54,42 @@ const lest::test specification[] = {
     EXPECT(shop->Sell(prod1) == 20.0);
   },
 
+  CASE("price changed while sales are stopped is kept") {
+    ProductBasePtr prod1(new ProductBase(10.0));
+
+    prod1->ChangePrice(20.0);
+    EXPECT(prod1->GetPrice() < 0);
+
+    prod1->StartSales();
+    EXPECT(prod1->GetPrice() == 20.0);
+  },
+
+  CASE("price read while it changes is one that was set") {
+    ProductBasePtr prod1(new ProductBase(10.0));
+    prod1->StartSales();
+
+    std::atomic_bool stop(false);
+    std::thread writer([&]() {
+      for (int i = 0; !stop; i++) {
+        prod1->ChangePrice(i % 2 ? 10.0 : 20.0);
+        if (i % 3 == 0) {
+          prod1->StopSales();
+          prod1->StartSales();
+        }
+      }
+    });
+
+    bool all_right = true;
+    for (int i = 0; i < 100000; i++) {
+      double price = prod1->GetPrice();
+      all_right &= price == -1.0 || price == 10.0 || price == 20.0;
+    }
+    stop = true;
+    writer.join();
+
+    EXPECT(all_right);
+  },
+
   CASE("shop can be destroyed and it's OK") {
     ShopBasePtr shop1(new ShopBase()), shop2(new ShopBase());
 
@@ -64,6 +105,327 @@ const lest::test specification[] = {
     shop1.reset();
 
     EXPECT(shop2->Sell(prod) == 10.0);
+  },
+
+  CASE("products have distinct stable ids") {
+    ProductBasePtr prod1(new ProductBase(10.0)), prod2(new ProductBase(10.0));
+
+    EXPECT(prod1->GetId() != 0);
+    EXPECT(prod1->GetId() != prod2->GetId());
+    EXPECT(prod1->GetId() == prod1->GetId());
+  },
+
+  CASE("id of a destroyed product stays stale when its slot is reused") {
+    ShopBasePtr shop(new ShopBase());
+    ProductBasePtr prod1(new ProductBase(10.0));
+    prod1->StartSales();
+    prod1->Attach(shop);
+    ProductId id1 = prod1->GetId();
+
+    EXPECT(shop->Sell(id1) == 10.0);
+
+    prod1.reset();
+    ProductBasePtr prod2(new ProductBase(20.0));
+    prod2->StartSales();
+    prod2->Attach(shop);
+
+    EXPECT(prod2->GetId() != id1);
+    EXPECT(shop->Sell(id1) < 0);
+    EXPECT(shop->Sell(prod2->GetId()) == 20.0);
+  },
+
+  CASE("can sell by product id") {
+    ShopBasePtr shop(new ShopBase());
+    ProductBasePtr prod1(new ProductBase(10.0)), prod2(new ProductBase(20.0));
+
+    prod1->Attach(shop);
+    prod1->StartSales();
+    prod2->StartSales();
+
+    EXPECT(shop->Sell(prod1->GetId()) == 10.0);
+    EXPECT(shop->Sell(prod2->GetId()) < 0);
+
+    ProductId id = prod1->GetId();
+    prod1.reset();
+
+    EXPECT(shop->Sell(id) < 0);
+  },
+
+  CASE("removing a product the shop doesn't have is harmless") {
+    ShopBasePtr shop(new ShopBase());
+    ProductBasePtr prod1(new ProductBase(10.0));
+
+    shop->RemoveProduct(prod1);
+    prod1->Detach(shop);
+
+    EXPECT(shop->Sell(prod1) < 0);
+  },
+
+  CASE("shop keeps many products") {
+    ShopBasePtr shop(new ShopBase());
+    std::vector<ProductBasePtr> prods;
+
+    for (int i = 0; i < 1000; i++) {
+      prods.emplace_back(new ProductBase(i));
+      prods.back()->StartSales();
+      shop->AddProduct(prods.back());
+    }
+    for (int i = 0; i < 1000; i += 2) {
+      shop->RemoveProduct(prods[i]);
+    }
+
+    bool all_right = true;
+    for (int i = 0; i < 1000; i++) {
+      double price = shop->Sell(prods[i]);
+      all_right &= i % 2 == 0 ? price < 0 : price == i;
+    }
+    EXPECT(all_right);
+  },
+
+  CASE("product leaves only the shop it is detached from") {
+    std::vector<ShopBasePtr> shops;
+    ProductBasePtr prod(new ProductBase(10.0));
+    for (int i = 0; i < 5; i++) {
+      shops.emplace_back(new ShopBase());
+      prod->Attach(shops.back());
+    }
+    prod->StartSales();
+
+    shops[1].reset();
+    prod->Detach(shops[3]);
+    prod->Detach(shops[3]);
+    prod->StopSales();
+    prod->StartSales();
+
+    EXPECT(shops[0]->Sell(prod) == 10.0);
+    EXPECT(shops[2]->Sell(prod) == 10.0);
+    EXPECT(shops[3]->Sell(prod) < 0);
+    EXPECT(shops[4]->Sell(prod) == 10.0);
+  },
+
+  CASE("shops attached while sales start and stop follow the last of them") {
+    std::vector<ShopBasePtr> shops;
+    for (int i = 0; i < 32; i++) {
+      shops.emplace_back(new ShopBase());
+    }
+    ProductBasePtr prod1(new ProductBase(10.0));
+
+    std::thread toggler([&]() {
+      for (int i = 0; i < 64; i++) {
+        prod1->StartSales();
+        prod1->StopSales();
+      }
+    });
+    for (auto& shop: shops) {
+      prod1->Attach(shop);
+    }
+    toggler.join();
+
+    prod1->StopSales();
+    bool none_listed = true;
+    for (auto& shop: shops) {
+      none_listed &= shop->Stock(prod1->GetId()) == -1;
+    }
+    EXPECT(none_listed);
+
+    prod1->StartSales();
+    bool all_sell = true;
+    for (auto& shop: shops) {
+      all_sell &= shop->Sell(prod1->GetId()) == 10.0;
+    }
+    EXPECT(all_sell);
+  },
+
+  CASE("can sell a basket at once") {
+    ShopBasePtr shop(new ShopBase());
+    ProductBasePtr prod1(new ProductBase(1));
+    ProductBasePtr prod2(new ProductBase(2));
+    ProductBasePtr prod3(new ProductBase(3));
+    prod1->StartSales();
+    prod2->StartSales();
+    prod1->Attach(shop);
+    prod2->Attach(shop);
+    prod3->Attach(shop);
+
+    std::vector<ProductId> ids = {prod2->GetId(), prod3->GetId(), 0, prod1->GetId(), prod2->GetId()};
+    std::vector<double> prices(ids.size());
+    shop->SellBatch(ids, prices);
+
+    EXPECT(prices == std::vector<double>({2, -1, -1, 1, 2}));
+
+    std::vector<double> short_prices(2, 0.0);
+    shop->SellBatch(ids, short_prices);
+    EXPECT(short_prices == std::vector<double>({2, -1}));
+  },
+
+  CASE("bulk imported products are listed together") {
+    ShopBasePtr shop(new ShopBase(3));
+    std::vector<ProductBasePtr> prods;
+    std::vector<IProductPtr> all;
+    std::vector<ProductId> ids;
+    for (int i = 0; i < 100; i++) {
+      prods.emplace_back(new ProductBase(i));
+      prods.back()->StartSales();
+      all.push_back(prods.back());
+      ids.push_back(prods.back()->GetId());
+    }
+
+    EXPECT(shop->Shards() == 4u);
+    EXPECT(shop->ListProducts().empty());
+
+    shop->AddProducts(all);
+    all.clear();
+    prods[7].reset();
+    ids.erase(ids.begin() + 7);
+
+    std::vector<ProductId> listed = shop->ListProducts();
+    std::sort(listed.begin(), listed.end());
+    std::sort(ids.begin(), ids.end());
+    EXPECT(listed == ids);
+    EXPECT(shop->Sell(prods[42]) == 42);
+  },
+
+  CASE("product sells out and can be restocked") {
+    ShopBasePtr shop(new ShopBase());
+    ProductBasePtr prod1(new ProductBase(10.0));
+    prod1->StartSales();
+    shop->AddProduct(prod1, 2);
+
+    EXPECT(shop->Stock(prod1->GetId()) == 2);
+    EXPECT(shop->Sell(prod1) == 10.0);
+    EXPECT(shop->Sell(prod1->GetId()) == 10.0);
+    EXPECT(shop->Sell(prod1) < 0);
+    EXPECT(shop->Stock(prod1->GetId()) == 0);
+
+    EXPECT(shop->Restock(prod1->GetId(), 1));
+    EXPECT(shop->Sell(prod1) == 10.0);
+    EXPECT(shop->Sell(prod1) < 0);
+
+    EXPECT(shop->SetStock(prod1->GetId(), StockCounter::kUnlimited));
+    EXPECT(shop->Sell(prod1) == 10.0);
+    EXPECT(shop->Stock(prod1->GetId()) == StockCounter::kUnlimited);
+  },
+
+  CASE("product not for sale keeps its stock") {
+    ShopBasePtr shop(new ShopBase());
+    ProductBasePtr prod1(new ProductBase(10.0));
+    shop->AddProduct(prod1, 1);
+
+    EXPECT(shop->Sell(prod1) < 0);
+    EXPECT(shop->Stock(prod1->GetId()) == 1);
+    EXPECT(!shop->Restock(prod1->GetId() + 1, 1));
+  },
+
+  CASE("stock survives stopping and restarting sales") {
+    ShopBasePtr shop(new ShopBase());
+    ProductBasePtr prod1(new ProductBase(10.0));
+    prod1->StartSales();
+    prod1->Attach(shop);
+    EXPECT(shop->SetStock(prod1->GetId(), 1));
+
+    prod1->StopSales();
+    EXPECT(shop->Stock(prod1->GetId()) == -1);
+    prod1->StartSales();
+
+    EXPECT(shop->Stock(prod1->GetId()) == 1);
+    EXPECT(shop->Sell(prod1) == 10.0);
+    EXPECT(shop->Sell(prod1) < 0);
+  },
+
+  CASE("adding a listed product again sets its stock") {
+    ShopBasePtr shop(new ShopBase());
+    ProductBasePtr prod1(new ProductBase(10.0));
+    prod1->StartSales();
+    shop->AddProduct(prod1, 1);
+    shop->AddProduct(prod1, 3);
+
+    EXPECT(shop->Stock(prod1->GetId()) == 3);
+    shop->AddProduct(prod1);
+    EXPECT(shop->Stock(prod1->GetId()) == 3);
+  },
+
+  CASE("restock rejects negative counts and saturates at unlimited") {
+    ShopBasePtr shop(new ShopBase());
+    ProductBasePtr prod1(new ProductBase(10.0));
+    prod1->StartSales();
+    shop->AddProduct(prod1, 2);
+
+    EXPECT(!shop->Restock(prod1->GetId(), -1));
+    EXPECT(!shop->SetStock(prod1->GetId(), -1));
+    EXPECT(shop->Stock(prod1->GetId()) == 2);
+
+    EXPECT(shop->Restock(prod1->GetId(), StockCounter::kUnlimited - 1));
+    EXPECT(shop->Stock(prod1->GetId()) == StockCounter::kUnlimited);
+    EXPECT(shop->Sell(prod1) == 10.0);
+    EXPECT(shop->Stock(prod1->GetId()) == StockCounter::kUnlimited);
+  },
+
+  CASE("basket is sold whole or not at all") {
+    ShopBasePtr shop(new ShopBase());
+    ProductBasePtr prod1(new ProductBase(1));
+    ProductBasePtr prod2(new ProductBase(2));
+    prod1->StartSales();
+    prod2->StartSales();
+    shop->AddProduct(prod1, 3);
+    shop->AddProduct(prod2, 1);
+
+    std::vector<ProductId> basket = {prod1->GetId(), prod2->GetId(), prod1->GetId()};
+    std::vector<double> prices(basket.size());
+
+    std::vector<double> short_prices(basket.size() - 1);
+    EXPECT(!shop->SellBasket(basket, short_prices));
+    EXPECT(shop->Stock(prod1->GetId()) == 3);
+    EXPECT(shop->SellBasket(basket, prices));
+    EXPECT(prices == std::vector<double>({1, 2, 1}));
+    EXPECT(!shop->SellBasket(basket, prices));
+    EXPECT(shop->Stock(prod1->GetId()) == 1);
+    EXPECT(shop->Stock(prod2->GetId()) == 0);
+  },
+
+  CASE("stock is not oversold by racing sellers") {
+    ShopBasePtr shop(new ShopBase());
+    ProductBasePtr prod1(new ProductBase(10.0));
+    prod1->StartSales();
+    shop->AddProduct(prod1, 1000);
+
+    std::atomic<int> sold(0);
+    std::vector<std::thread> sellers;
+    for (int t = 0; t < 4; t++) {
+      sellers.emplace_back([&]() {
+        for (int i = 0; i < 1000; i++) {
+          if (shop->Sell(prod1->GetId()) > 0) {
+            sold++;
+          }
+        }
+      });
+    }
+    for (auto& s: sellers) {
+      s.join();
+    }
+
+    EXPECT(sold == 1000);
+    EXPECT(shop->Stock(prod1->GetId()) == 0);
+  },
+
+  CASE("batched edits show up when the batch closes") {
+    ShopBasePtr shop(new ShopBase());
+    ProductBasePtr prod1(new ProductBase(1));
+    ProductBasePtr prod2(new ProductBase(2));
+    prod1->StartSales();
+    prod2->StartSales();
+    shop->AddProduct(prod1);
+
+    {
+      ShopBase::Batch batch(*shop);
+      shop->RemoveProduct(prod1);
+      shop->AddProduct(prod2);
+
+      EXPECT(shop->Sell(prod1) == 1);
+      EXPECT(shop->Sell(prod2) < 0);
+    }
+
+    EXPECT(shop->Sell(prod1) < 0);
+    EXPECT(shop->Sell(prod2) == 2);
   }
 };
 